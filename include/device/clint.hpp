@@ -0,0 +1,153 @@
+#ifndef RISCV_ISA_CLINT_HPP
+#define RISCV_ISA_CLINT_HPP
+
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "riscv_isa_utility.hpp"
+#include "trap/trap.hpp"
+#include "target/timer_wheel.hpp"
+
+
+namespace riscv_isa {
+    /// core local interruptor with the register layout of sifive clint. writing msip of a hart sets or clears its
+    /// machine software interrupt pending bit in the attention word of target hart, which takes no lock and wakes the
+    /// hart if it is parked in wfi. a hart with no pending interrupt pays nothing for it.
+    ///
+    /// mtimecmp of a hart is an event in the timer wheel of that hart, which raises the machine timer interrupt on
+    /// the thread of the hart once its time reaches mtimecmp, and a hart parked in wfi sleeps until then. mtime is
+    /// the time csr of hart 0 and cannot be written.
+    template<typename HartT>
+    class CLINT {
+    public:
+        static constexpr usize MSIP_BASE = 0x0000;
+        static constexpr usize MTIMECMP_BASE = 0x4000;
+        static constexpr usize MTIME = 0xbff8;
+        static constexpr usize SIZE = 0x10000;
+
+    private:
+        struct Timer {
+        public:
+            TimerEvent event;
+            u64 mtimecmp;
+
+            Timer() : event{}, mtimecmp{TimerWheel::NO_DEADLINE} {}
+        };
+
+        std::vector<HartT *> harts;
+        std::vector<std::unique_ptr<Timer>> timers;
+        /// serializes mtimecmp writes with expiring, so an old event cannot raise the interrupt after a write.
+        std::mutex lock;
+
+    public:
+        CLINT() = default;
+
+        CLINT(const CLINT &other) = delete;
+
+        CLINT &operator=(const CLINT &other) = delete;
+
+        /// msip index is the order harts are attached in.
+        void attach(HartT &hart) {
+            harts.push_back(&hart);
+            timers.emplace_back(new Timer{});
+            timers.back()->event.connect(*this, harts.size() - 1);
+        }
+
+        usize get_hart_num() const { return harts.size(); }
+
+        bool get_msip(usize hart_id) const {
+            riscv_isa_assert(hart_id < harts.size());
+            return (harts[hart_id]->get_interrupt_pending() & (1u << trap::MACHINE_SOFTWARE_INTERRUPT)) != 0;
+        }
+
+        void set_msip(usize hart_id, bool val) {
+            riscv_isa_assert(hart_id < harts.size());
+            if (val) harts[hart_id]->raise_interrupt(trap::MACHINE_SOFTWARE_INTERRUPT);
+            else harts[hart_id]->clear_interrupt(trap::MACHINE_SOFTWARE_INTERRUPT);
+        }
+
+        u64 get_mtime() const {
+            riscv_isa_assert(!harts.empty());
+            return harts[0]->get_time();
+        }
+
+        u64 get_mtimecmp(usize hart_id) {
+            riscv_isa_assert(hart_id < harts.size());
+            std::lock_guard<std::mutex> guard{lock};
+            return timers[hart_id]->mtimecmp;
+        }
+
+        /// the interrupt is raised at once if the time of hart already reached val.
+        void set_mtimecmp(usize hart_id, u64 val) {
+            riscv_isa_assert(hart_id < harts.size());
+            std::lock_guard<std::mutex> guard{lock};
+            HartT *hart = harts[hart_id];
+            Timer &timer = *timers[hart_id];
+
+            timer.mtimecmp = val;
+            if (hart->get_time() >= val) {
+                hart->cancel_timer(timer.event);
+                hart->raise_interrupt(trap::MACHINE_TIMER_INTERRUPT);
+            } else {
+                hart->clear_interrupt(trap::MACHINE_TIMER_INTERRUPT);
+                hart->schedule_timer(timer.event, val);
+            }
+        }
+
+        /// timer event of hart_id, called on the thread of that hart.
+        void expire(usize hart_id) {
+            std::lock_guard<std::mutex> guard{lock};
+            if (harts[hart_id]->get_time() >= timers[hart_id]->mtimecmp)
+                harts[hart_id]->raise_interrupt(trap::MACHINE_TIMER_INTERRUPT);
+        }
+
+        /// register access by offset from the base of clint, only bit 0 of msip is implemented, mtimecmp and mtime
+        /// are accessed as two words. false if offset is not mapped.
+
+        bool read(usize offset, u32 &val) {
+            if (offset % sizeof(u32) != 0) return false;
+
+            if (offset < MTIMECMP_BASE) {
+                usize hart_id = (offset - MSIP_BASE) / sizeof(u32);
+                if (hart_id >= harts.size()) return false;
+                val = get_msip(hart_id) ? 1 : 0;
+            } else if (offset >= MTIME && offset < MTIME + sizeof(u64)) {
+                val = static_cast<u32>(get_mtime() >> (offset - MTIME) * 8);
+            } else {
+                usize hart_id = (offset - MTIMECMP_BASE) / sizeof(u64);
+                if (hart_id >= harts.size()) return false;
+                val = static_cast<u32>(get_mtimecmp(hart_id) >> (offset - MTIMECMP_BASE) % sizeof(u64) * 8);
+            }
+
+            return true;
+        }
+
+        bool write(usize offset, u32 val) {
+            if (offset % sizeof(u32) != 0) return false;
+
+            if (offset < MTIMECMP_BASE) {
+                usize hart_id = (offset - MSIP_BASE) / sizeof(u32);
+                if (hart_id >= harts.size()) return false;
+                set_msip(hart_id, (val & 1u) != 0);
+            } else if (offset >= MTIME && offset < MTIME + sizeof(u64)) {
+                return true; // time is derived from the hart and cannot be set.
+            } else {
+                usize hart_id = (offset - MTIMECMP_BASE) / sizeof(u64);
+                if (hart_id >= harts.size()) return false;
+
+                usize shift = (offset - MTIMECMP_BASE) % sizeof(u64) * 8;
+                u64 mtimecmp = get_mtimecmp(hart_id) & ~(static_cast<u64>(0xffffffffu) << shift);
+                set_mtimecmp(hart_id, mtimecmp | static_cast<u64>(val) << shift);
+            }
+
+            return true;
+        }
+
+        ~CLINT() { for (usize i = 0; i < harts.size(); ++i) harts[i]->cancel_timer(timers[i]->event); }
+    };
+}
+
+
+#endif //RISCV_ISA_CLINT_HPP
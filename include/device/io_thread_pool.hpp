@@ -0,0 +1,102 @@
+#ifndef RISCV_ISA_IO_THREAD_POOL_HPP
+#define RISCV_ISA_IO_THREAD_POOL_HPP
+
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "riscv_isa_utility.hpp"
+
+
+namespace riscv_isa {
+    /// host threads doing device work off the hart threads. a hart writing a doorbell register only posts the
+    /// device and returns, the device is processed on an io thread and reports completion through its interrupt
+    /// line, so guest execution overlaps host io latency. DeviceT posted is required to implement:
+    ///
+    ///     /// do all work pending at the time of call.
+    ///     void process();
+    ///
+    /// a device is expected to post itself at most once until its process starts, so doorbells arriving while it
+    /// is queued are coalesced, and to serialize its own process calls if it is posted to a pool of several threads.
+    class IOThreadPool {
+    private:
+        struct Job {
+        public:
+            void *device;
+            void (*process)(void *device);
+        };
+
+        template<typename DeviceT>
+        static void process_device(void *device) { static_cast<DeviceT *>(device)->process(); }
+
+        std::mutex lock;
+        std::condition_variable ready, idle;
+        std::deque<Job> jobs;
+        usize busy;
+        bool stopping;
+        std::vector<std::thread> threads;
+
+        void work() {
+            std::unique_lock<std::mutex> guard{lock};
+
+            while (true) {
+                ready.wait(guard, [this]() { return stopping || !jobs.empty(); });
+                if (jobs.empty()) return; // stopping, and every posted job is done.
+
+                Job job = jobs.front();
+                jobs.pop_front();
+                ++busy;
+
+                guard.unlock();
+                job.process(job.device);
+                guard.lock();
+
+                --busy;
+                if (jobs.empty() && busy == 0) idle.notify_all();
+            }
+        }
+
+    public:
+        explicit IOThreadPool(usize thread_num = 1) : busy{0}, stopping{false} {
+            if (thread_num == 0) thread_num = 1;
+            for (usize i = 0; i < thread_num; ++i) threads.emplace_back([this]() { work(); });
+        }
+
+        IOThreadPool(const IOThreadPool &other) = delete;
+
+        IOThreadPool &operator=(const IOThreadPool &other) = delete;
+
+        template<typename DeviceT>
+        void post(DeviceT &device) {
+            {
+                std::lock_guard<std::mutex> guard{lock};
+                jobs.push_back(Job{&device, &process_device<DeviceT>});
+            }
+
+            ready.notify_one();
+        }
+
+        /// wait until every posted job is done.
+        void wait_idle() {
+            std::unique_lock<std::mutex> guard{lock};
+            idle.wait(guard, [this]() { return jobs.empty() && busy == 0; });
+        }
+
+        /// posted jobs are finished before threads exit.
+        ~IOThreadPool() {
+            {
+                std::lock_guard<std::mutex> guard{lock};
+                stopping = true;
+            }
+
+            ready.notify_all();
+            for (auto &thread: threads) thread.join();
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_IO_THREAD_POOL_HPP
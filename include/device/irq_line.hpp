@@ -0,0 +1,57 @@
+#ifndef RISCV_ISA_IRQ_LINE_HPP
+#define RISCV_ISA_IRQ_LINE_HPP
+
+
+#include "riscv_isa_utility.hpp"
+
+
+namespace riscv_isa {
+    /// level triggered interrupt output of a device. it is either connected to an interrupt controller, which is
+    /// required to implement:
+    ///
+    ///     /// may be called from any thread.
+    ///     void set_irq(usize id, bool level);
+    ///
+    /// or directly to an interrupt pending bit of a hart. an unconnected line does nothing. set may be called from
+    /// any thread, including io threads, with the lock of device held.
+    class IRQLine {
+    private:
+        void *target;
+        usize id;
+        void (*setter)(void *target, usize id, bool level);
+
+        template<typename TargetT>
+        static void set_target(void *target, usize id, bool level) {
+            static_cast<TargetT *>(target)->set_irq(id, level);
+        }
+
+        template<typename HartT>
+        static void set_hart(void *target, usize id, bool level) {
+            if (level) static_cast<HartT *>(target)->raise_interrupt(id);
+            else static_cast<HartT *>(target)->clear_interrupt(id);
+        }
+
+    public:
+        IRQLine() : target{nullptr}, id{0}, setter{nullptr} {}
+
+        template<typename TargetT>
+        void connect(TargetT &controller, usize irq) {
+            target = &controller;
+            id = irq;
+            setter = &set_target<TargetT>;
+        }
+
+        /// interrupt is a code in trap, such as MACHINE_EXTERNAL_INTERRUPT.
+        template<typename HartT>
+        void connect_hart(HartT &hart, usize interrupt) {
+            target = &hart;
+            id = interrupt;
+            setter = &set_hart<HartT>;
+        }
+
+        void set(bool level) const { if (setter != nullptr) setter(target, id, level); }
+    };
+}
+
+
+#endif //RISCV_ISA_IRQ_LINE_HPP
@@ -0,0 +1,139 @@
+#ifndef RISCV_ISA_MMIO_BUS_HPP
+#define RISCV_ISA_MMIO_BUS_HPP
+
+
+#include <vector>
+
+#include "riscv_isa_utility.hpp"
+
+
+namespace riscv_isa {
+    /// maps physical address ranges to devices, for the mmio_load and mmio_store fallback of a hart. DeviceT is
+    /// required to implement:
+    ///
+    ///     /// register access by offset from the base of device, false if offset is not mapped.
+    ///     bool read(usize offset, u32 &val);
+    ///
+    ///     bool write(usize offset, u32 val);
+    ///
+    /// narrower accesses are passed as one 32 bit access with the low bytes used, 64 bit accesses as two 32 bit
+    /// accesses of the low word first. devices are called from hart threads concurrently and are responsible for
+    /// their own locking. ranges must be mapped before any hart starts.
+    ///
+    /// ranges of host memory may be mapped as well, they are not devices but guest physical memory which harts
+    /// access in place, by looking up address when their own memory has no host address for it.
+    class MMIOBus {
+    private:
+        struct Memory {
+        public:
+            u64 base, size;
+            u8 *host;
+        };
+
+        struct Region {
+        public:
+            u64 base, size;
+            void *device;
+            bool (*read)(void *device, usize offset, u32 &val);
+            bool (*write)(void *device, usize offset, u32 val);
+        };
+
+        template<typename DeviceT>
+        static bool device_read(void *device, usize offset, u32 &val) {
+            return static_cast<DeviceT *>(device)->read(offset, val);
+        }
+
+        template<typename DeviceT>
+        static bool device_write(void *device, usize offset, u32 val) {
+            return static_cast<DeviceT *>(device)->write(offset, val);
+        }
+
+        std::vector<Region> regions;
+        std::vector<Memory> memories;
+
+        const Region *find(u64 addr) const {
+            for (auto &region: regions)
+                if (addr - region.base < region.size) return &region;
+
+            return nullptr;
+        }
+
+    public:
+        MMIOBus() = default;
+
+        MMIOBus(const MMIOBus &other) = delete;
+
+        MMIOBus &operator=(const MMIOBus &other) = delete;
+
+        /// true if the range overlaps a mapped device or memory range.
+        bool overlaps(u64 base, u64 size) const {
+            for (auto &region: regions)
+                if (base < region.base + region.size && region.base < base + size) return true;
+
+            for (auto &memory: memories)
+                if (base < memory.base + memory.size && memory.base < base + size) return true;
+
+            return false;
+        }
+
+        /// false if the range overlaps a mapped range.
+        template<typename DeviceT>
+        bool map(u64 base, u64 size, DeviceT &device) {
+            if (overlaps(base, size)) return false;
+
+            regions.push_back(Region{base, size, &device, &device_read<DeviceT>, &device_write<DeviceT>});
+            return true;
+        }
+
+        /// host memory of size bytes, owned by caller, as guest physical memory at base. false if the range overlaps
+        /// a mapped range.
+        bool map_memory(u64 base, u64 size, void *host) {
+            if (overlaps(base, size)) return false;
+
+            memories.push_back(Memory{base, size, static_cast<u8 *>(host)});
+            return true;
+        }
+
+        /// host address of the value at addr in mapped memory, nullptr if it is not all in one range.
+        template<typename ValT>
+        ValT *address(u64 addr) const {
+            for (auto &memory: memories)
+                if (addr - memory.base < memory.size && sizeof(ValT) <= memory.base + memory.size - addr)
+                    return reinterpret_cast<ValT *>(memory.host + (addr - memory.base));
+
+            return nullptr;
+        }
+
+        template<typename ValT>
+        bool load(u64 addr, ValT &val) const {
+            const Region *region = find(addr);
+            if (region == nullptr) return false;
+
+            usize offset = addr - region->base;
+            u32 low = 0, high = 0;
+            if (!region->read(region->device, offset, low)) return false;
+            if (sizeof(ValT) > sizeof(u32) && !region->read(region->device, offset + sizeof(u32), high)) return false;
+
+            val = static_cast<ValT>(static_cast<u64>(high) << 32u | low);
+            return true;
+        }
+
+        template<typename ValT>
+        bool store(u64 addr, ValT val) const {
+            const Region *region = find(addr);
+            if (region == nullptr) return false;
+
+            usize offset = addr - region->base;
+            u64 word = static_cast<u64>(val);
+            if (!region->write(region->device, offset, static_cast<u32>(word))) return false;
+            if (sizeof(ValT) > sizeof(u32) && !region->write(region->device, offset + sizeof(u32),
+                                                             static_cast<u32>(word >> 32u)))
+                return false;
+
+            return true;
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_MMIO_BUS_HPP
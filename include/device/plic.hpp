@@ -0,0 +1,247 @@
+#ifndef RISCV_ISA_PLIC_HPP
+#define RISCV_ISA_PLIC_HPP
+
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "riscv_isa_utility.hpp"
+#include "trap/trap.hpp"
+
+
+namespace riscv_isa {
+    /// platform level interrupt controller with the register layout of sifive plic. every attached hart has two
+    /// contexts, machine mode at 2 * i and supervisor mode at 2 * i + 1, driving its meip and seip bits in the
+    /// attention word.
+    ///
+    /// sources are level triggered. a source with its line high becomes pending unless it has been claimed and not
+    /// completed yet, completing a source whose line is still high makes it pending again.
+    ///
+    /// every piece of state is an atomic word and there is no lock. set_irq, claim and complete change the bitmaps,
+    /// bump generation, then recompute the external interrupt bits of every hart from the bitmaps, and do it again if
+    /// generation changed meanwhile. so the bits written last are always computed after the last change, and
+    /// devices on io threads raise interrupts without blocking harts or each other.
+    template<typename HartT>
+    class PLIC {
+    public:
+        static constexpr usize SOURCE_NUM = 128; // source 0 does not exist.
+        static constexpr usize WORD_NUM = SOURCE_NUM / 32;
+        static constexpr u32 PRIORITY_MASK = 0x7;
+
+        static constexpr usize PRIORITY_BASE = 0x000000;
+        static constexpr usize PENDING_BASE = 0x001000;
+        static constexpr usize ENABLE_BASE = 0x002000;
+        static constexpr usize ENABLE_STRIDE = 0x80;
+        static constexpr usize CONTEXT_BASE = 0x200000;
+        static constexpr usize CONTEXT_STRIDE = 0x1000;
+        static constexpr usize SIZE = 0x4000000;
+
+    private:
+        using UXLenT = typename HartT::UXLenT;
+
+        struct Context {
+        public:
+            std::atomic<u32> enable[WORD_NUM];
+            std::atomic<u32> threshold;
+
+            Context() : threshold{0} { for (auto &word: enable) word.store(0, std::memory_order_relaxed); }
+        };
+
+        std::vector<HartT *> harts;
+        std::vector<std::unique_ptr<Context>> contexts;
+        std::atomic<u32> priority[SOURCE_NUM];
+        std::atomic<u32> pending[WORD_NUM], claimed[WORD_NUM], level[WORD_NUM];
+        std::atomic<u32> generation;
+
+        static u32 bit(usize id) { return 1u << (id % 32); }
+
+        usize get_context_num() const { return contexts.size(); }
+
+        /// highest priority source pending and enabled in context, ties go to the lower id. 0 if there is none.
+        usize best(usize context, u32 &best_priority) const {
+            usize id = 0;
+            best_priority = 0;
+
+            for (usize i = 0; i < WORD_NUM; ++i) {
+                u32 word = pending[i].load(std::memory_order_acquire) &
+                           contexts[context]->enable[i].load(std::memory_order_relaxed);
+
+                for (; word != 0; word &= word - 1) {
+                    usize source = i * 32 + __builtin_ctz(word);
+                    u32 prio = priority[source].load(std::memory_order_relaxed);
+                    if (prio > best_priority) {
+                        best_priority = prio;
+                        id = source;
+                    }
+                }
+            }
+
+            return id;
+        }
+
+        void bump() { generation.fetch_add(1, std::memory_order_acq_rel); }
+
+        void update() {
+            u32 gen = generation.load(std::memory_order_acquire);
+
+            while (true) {
+                for (usize context = 0; context < get_context_num(); ++context) {
+                    u32 prio;
+                    bool active = best(context, prio) != 0 &&
+                                  prio > contexts[context]->threshold.load(std::memory_order_relaxed);
+                    HartT *hart = harts[context / 2];
+                    UXLenT code = context % 2 == 0 ? trap::MACHINE_EXTERNAL_INTERRUPT :
+                                  trap::SUPERVISOR_EXTERNAL_INTERRUPT;
+
+                    if (active) hart->raise_interrupt(code);
+                    else hart->clear_interrupt(code);
+                }
+
+                u32 now = generation.load(std::memory_order_acquire);
+                if (now == gen) return;
+                gen = now;
+            }
+        }
+
+    public:
+        PLIC() : generation{0} {
+            for (auto &word: priority) word.store(0, std::memory_order_relaxed);
+            for (usize i = 0; i < WORD_NUM; ++i) {
+                pending[i].store(0, std::memory_order_relaxed);
+                claimed[i].store(0, std::memory_order_relaxed);
+                level[i].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        PLIC(const PLIC &other) = delete;
+
+        PLIC &operator=(const PLIC &other) = delete;
+
+        /// context index is 2 * the order harts are attached in. attach every hart before any source is raised.
+        void attach(HartT &hart) {
+            harts.push_back(&hart);
+            contexts.emplace_back(new Context{});
+            contexts.emplace_back(new Context{});
+        }
+
+        usize get_hart_num() const { return harts.size(); }
+
+        /// line level of source id, called by devices from any thread.
+        void set_irq(usize id, bool val) {
+            if (id == 0 || id >= SOURCE_NUM) return;
+
+            // only a rising edge makes the source pending, a line already high is pending or claimed. seq_cst, so
+            // either this sees the claim completed or complete sees the level high.
+            if (val) {
+                if ((level[id / 32].fetch_or(bit(id)) & bit(id)) != 0) return;
+                if ((claimed[id / 32].load() & bit(id)) == 0)
+                    pending[id / 32].fetch_or(bit(id));
+            } else {
+                level[id / 32].fetch_and(~bit(id));
+                pending[id / 32].fetch_and(~bit(id));
+            }
+
+            bump();
+            update();
+        }
+
+        /// take the best pending source of context, 0 if there is none. a source is taken by one context only.
+        usize claim(usize context) {
+            usize id;
+
+            while (true) {
+                u32 prio;
+                id = best(context, prio);
+                if (id == 0) break;
+
+                // lost the race if another context took the source first.
+                if ((pending[id / 32].fetch_and(~bit(id)) & bit(id)) != 0) {
+                    claimed[id / 32].fetch_or(bit(id));
+                    break;
+                }
+            }
+
+            bump();
+            update();
+            return id;
+        }
+
+        /// ignored if source is not enabled in context.
+        void complete(usize context, usize id) {
+            if (id == 0 || id >= SOURCE_NUM) return;
+            if ((contexts[context]->enable[id / 32].load(std::memory_order_relaxed) & bit(id)) == 0) return;
+
+            claimed[id / 32].fetch_and(~bit(id));
+            if ((level[id / 32].load() & bit(id)) != 0)
+                pending[id / 32].fetch_or(bit(id));
+
+            bump();
+            update();
+        }
+
+        /// register access by offset from the base of plic. false if offset is not mapped.
+
+        bool read(usize offset, u32 &val) {
+            if (offset % sizeof(u32) != 0) return false;
+
+            if (offset < PENDING_BASE) {
+                usize id = (offset - PRIORITY_BASE) / sizeof(u32);
+                if (id >= SOURCE_NUM) return false;
+                val = priority[id].load(std::memory_order_relaxed);
+            } else if (offset < ENABLE_BASE) {
+                usize word = (offset - PENDING_BASE) / sizeof(u32);
+                if (word >= WORD_NUM) return false;
+                val = pending[word].load(std::memory_order_acquire);
+            } else if (offset < CONTEXT_BASE) {
+                usize context = (offset - ENABLE_BASE) / ENABLE_STRIDE;
+                usize word = (offset - ENABLE_BASE) % ENABLE_STRIDE / sizeof(u32);
+                if (context >= get_context_num() || word >= WORD_NUM) return false;
+                val = contexts[context]->enable[word].load(std::memory_order_relaxed);
+            } else {
+                usize context = (offset - CONTEXT_BASE) / CONTEXT_STRIDE;
+                usize reg = (offset - CONTEXT_BASE) % CONTEXT_STRIDE;
+                if (context >= get_context_num() || reg > sizeof(u32)) return false;
+                val = reg == 0 ? contexts[context]->threshold.load(std::memory_order_relaxed) :
+                      static_cast<u32>(claim(context));
+            }
+
+            return true;
+        }
+
+        bool write(usize offset, u32 val) {
+            if (offset % sizeof(u32) != 0) return false;
+
+            if (offset < PENDING_BASE) {
+                usize id = (offset - PRIORITY_BASE) / sizeof(u32);
+                if (id >= SOURCE_NUM) return false;
+                if (id != 0) priority[id].store(val & PRIORITY_MASK, std::memory_order_relaxed);
+            } else if (offset < ENABLE_BASE) {
+                return (offset - PENDING_BASE) / sizeof(u32) < WORD_NUM; // pending bits are read only.
+            } else if (offset < CONTEXT_BASE) {
+                usize context = (offset - ENABLE_BASE) / ENABLE_STRIDE;
+                usize word = (offset - ENABLE_BASE) % ENABLE_STRIDE / sizeof(u32);
+                if (context >= get_context_num() || word >= WORD_NUM) return false;
+                contexts[context]->enable[word].store(word == 0 ? val & ~1u : val, std::memory_order_relaxed);
+            } else {
+                usize context = (offset - CONTEXT_BASE) / CONTEXT_STRIDE;
+                usize reg = (offset - CONTEXT_BASE) % CONTEXT_STRIDE;
+                if (context >= get_context_num() || reg > sizeof(u32)) return false;
+
+                if (reg == 0) {
+                    contexts[context]->threshold.store(val & PRIORITY_MASK, std::memory_order_relaxed);
+                } else {
+                    complete(context, val);
+                    return true;
+                }
+            }
+
+            bump();
+            update();
+            return true;
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_PLIC_HPP
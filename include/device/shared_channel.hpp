@@ -0,0 +1,207 @@
+#ifndef RISCV_ISA_SHARED_CHANNEL_HPP
+#define RISCV_ISA_SHARED_CHANNEL_HPP
+
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "riscv_isa_utility.hpp"
+#include "irq_line.hpp"
+#include "mmio_bus.hpp"
+
+
+namespace riscv_isa {
+    /// bulk data channel between host and guest through a buffer of host memory, which is mapped on the bus as
+    /// guest physical memory, so neither side ever copies data. the registers only hand over lengths:
+    ///
+    /// host to guest, the host writes input at the start of the buffer and calls send with its length, which
+    /// raises the input interrupt, the guest reads INPUT_LENGTH and acknowledges the interrupt.
+    ///
+    /// guest to host, the guest writes output anywhere in the buffer, writes OUTPUT_OFFSET and OUTPUT_LENGTH and
+    /// then rings DOORBELL. a host thread waiting in wait_doorbell wakes and takes the output by get_output.
+    ///
+    /// registers are 32 bits wide, buffer is smaller than 4 GiB. the buffer belongs to whichever side was handed it
+    /// last, the channel does not check that.
+    class SharedChannel {
+    public:
+        static constexpr u32 MAGIC = 0x6c6e6863; // "chnl"
+        static constexpr u32 INTERRUPT_INPUT = 1;
+        static constexpr u64 SIZE = 0x1000;
+
+        enum : usize {
+            MAGIC_VALUE = 0x00,
+            BUFFER_BASE_LOW = 0x04,
+            BUFFER_BASE_HIGH = 0x08,
+            BUFFER_SIZE = 0x0c,
+            INPUT_LENGTH = 0x10,
+            OUTPUT_OFFSET = 0x14,
+            OUTPUT_LENGTH = 0x18,
+            DOORBELL = 0x1c,
+            INTERRUPT_STATUS = 0x20,
+            INTERRUPT_ACK = 0x24,
+        };
+
+    private:
+        std::mutex lock;
+        std::condition_variable rung;
+        u8 *buffer;
+        u64 buffer_base;
+        u32 buffer_size;
+        u32 input_length, output_offset, output_length;
+        /// number of doorbell writes, and value of the last one.
+        u32 doorbell_num, doorbell;
+        u32 interrupt_status;
+        IRQLine irq;
+
+    public:
+        /// buffer of size bytes is owned by caller.
+        SharedChannel(void *buffer, u64 size) :
+                buffer{static_cast<u8 *>(buffer)}, buffer_base{0}, buffer_size{static_cast<u32>(size)},
+                input_length{0}, output_offset{0}, output_length{0}, doorbell_num{0}, doorbell{0},
+                interrupt_status{0}, irq{} {
+            riscv_isa_assert(size <= 0xffffffffu);
+        }
+
+        SharedChannel(const SharedChannel &other) = delete;
+
+        SharedChannel &operator=(const SharedChannel &other) = delete;
+
+        /// registers at base, buffer as memory at buffer_base. false with nothing mapped if either overlaps a mapped
+        /// range or the other.
+        bool map(MMIOBus &bus, u64 base, u64 buffer_addr) {
+            bool apart = base + SIZE <= buffer_addr || buffer_addr + buffer_size <= base;
+            if (!apart || bus.overlaps(base, SIZE) || bus.overlaps(buffer_addr, buffer_size)) return false;
+
+            bus.map(base, SIZE, *this);
+            bus.map_memory(buffer_addr, buffer_size, buffer);
+
+            buffer_base = buffer_addr;
+            return true;
+        }
+
+        /// connect before the guest enables interrupts.
+        IRQLine &get_irq_line() { return irq; }
+
+        /// level of the interrupt line.
+        bool get_interrupt() {
+            std::lock_guard<std::mutex> guard{lock};
+            return interrupt_status != 0;
+        }
+
+        u8 *get_buffer() const { return buffer; }
+
+        u64 get_size() const { return buffer_size; }
+
+        /// hand the first length bytes of buffer to the guest. false if length exceeds the buffer.
+        bool send(u64 length) {
+            if (length > buffer_size) return false;
+
+            std::lock_guard<std::mutex> guard{lock};
+            input_length = static_cast<u32>(length);
+            interrupt_status |= INTERRUPT_INPUT;
+            irq.set(true);
+            return true;
+        }
+
+        u32 get_doorbell_num() {
+            std::lock_guard<std::mutex> guard{lock};
+            return doorbell_num;
+        }
+
+        /// wait until the doorbell was rung more than seen times, seen is updated to the count. false on timeout.
+        bool wait_doorbell(u32 &seen, std::chrono::nanoseconds timeout) {
+            std::unique_lock<std::mutex> guard{lock};
+            if (!rung.wait_for(guard, timeout, [this, seen]() { return doorbell_num != seen; })) return false;
+
+            seen = doorbell_num;
+            return true;
+        }
+
+        /// output the guest handed over by its last doorbell, and the value it rang with. nullptr if the range it
+        /// gave is outside the buffer.
+        const u8 *get_output(u64 &length, u32 &value) {
+            std::lock_guard<std::mutex> guard{lock};
+
+            value = doorbell;
+            length = output_length;
+            return output_offset <= buffer_size && output_length <= buffer_size - output_offset ?
+                   buffer + output_offset : nullptr;
+        }
+
+        /// register access by offset from the base of channel, only whole words. false if offset is not mapped.
+
+        bool read(usize offset, u32 &val) {
+            std::lock_guard<std::mutex> guard{lock};
+
+            switch (offset) {
+                case MAGIC_VALUE:
+                    val = MAGIC;
+                    return true;
+                case BUFFER_BASE_LOW:
+                    val = static_cast<u32>(buffer_base);
+                    return true;
+                case BUFFER_BASE_HIGH:
+                    val = static_cast<u32>(buffer_base >> 32u);
+                    return true;
+                case BUFFER_SIZE:
+                    val = buffer_size;
+                    return true;
+                case INPUT_LENGTH:
+                    val = input_length;
+                    return true;
+                case OUTPUT_OFFSET:
+                    val = output_offset;
+                    return true;
+                case OUTPUT_LENGTH:
+                    val = output_length;
+                    return true;
+                case DOORBELL:
+                    val = doorbell_num;
+                    return true;
+                case INTERRUPT_STATUS:
+                    val = interrupt_status;
+                    return true;
+                case INTERRUPT_ACK:
+                    val = 0;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        bool write(usize offset, u32 val) {
+            std::lock_guard<std::mutex> guard{lock};
+
+            switch (offset) {
+                case OUTPUT_OFFSET:
+                    output_offset = val;
+                    return true;
+                case OUTPUT_LENGTH:
+                    output_length = val;
+                    return true;
+                case DOORBELL:
+                    doorbell = val;
+                    ++doorbell_num;
+                    rung.notify_all();
+                    return true;
+                case INTERRUPT_ACK:
+                    interrupt_status &= ~val;
+                    if (interrupt_status == 0) irq.set(false);
+                    return true;
+                case MAGIC_VALUE:
+                case BUFFER_BASE_LOW:
+                case BUFFER_BASE_HIGH:
+                case BUFFER_SIZE:
+                case INPUT_LENGTH:
+                case INTERRUPT_STATUS:
+                    return true; // read only.
+                default:
+                    return false;
+            }
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_SHARED_CHANNEL_HPP
@@ -0,0 +1,339 @@
+#ifndef RISCV_ISA_UART_HPP
+#define RISCV_ISA_UART_HPP
+
+
+#include <cerrno>
+#include <chrono>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "riscv_isa_utility.hpp"
+#include "irq_line.hpp"
+#include "target/timer_wheel.hpp"
+
+
+namespace riscv_isa {
+    /// 16550 compatible uart with byte wide registers. transmitted bytes go to a ring buffer which is written to
+    /// the output fd in one call on newline, when it is full, or when the oldest byte in it is older than
+    /// FLUSH_INTERVAL_NS. the age is checked on every transmit and in poll, and by an event on the timer wheel of the
+    /// hart given to attach, so output with no newline, such as a prompt, is written even if nobody calls poll. a
+    /// guest printing byte by byte costs one system call per line instead of one per byte. the transmitter is
+    /// always ready.
+    ///
+    /// received bytes are read from the input fd, which is made non-blocking, into another ring buffer whenever
+    /// the guest finds it empty, at most once per INPUT_INTERVAL_NS, so guests polling the line status register do
+    /// not make a system call per poll.
+    ///
+    /// the interrupt line is level triggered, it is driven on irq line after every register access and poll, and
+    /// can be read by get_interrupt. baud rate, line control and modem control are stored and have no effect.
+    class UART {
+    public:
+        static constexpr usize BUFFER_SIZE = 4096;
+        static constexpr u64 FLUSH_INTERVAL_NS = 10000000;
+        static constexpr u64 FLUSH_INTERVAL_TICK = RISCV_TIME_FREQUENCY / (1000000000u / FLUSH_INTERVAL_NS);
+        static constexpr u64 INPUT_INTERVAL_NS = 1000000;
+
+        enum : usize {
+            RBR_THR_DLL = 0,
+            IER_DLM = 1,
+            IIR_FCR = 2,
+            LCR = 3,
+            MCR = 4,
+            LSR = 5,
+            MSR = 6,
+            SCR = 7,
+            REGISTER_NUM = 8,
+        };
+
+        static constexpr u8 IER_RDI = 0x01;
+        static constexpr u8 IER_THRI = 0x02;
+        static constexpr u8 IIR_NO_INT = 0x01;
+        static constexpr u8 IIR_THRI = 0x02;
+        static constexpr u8 IIR_RDI = 0x04;
+        static constexpr u8 IIR_FIFO = 0xc0;
+        static constexpr u8 FCR_ENABLE = 0x01;
+        static constexpr u8 FCR_CLEAR_RCVR = 0x02;
+        static constexpr u8 LCR_DLAB = 0x80;
+        static constexpr u8 LSR_DR = 0x01;
+        static constexpr u8 LSR_THRE = 0x20;
+        static constexpr u8 LSR_TEMT = 0x40;
+        static constexpr u8 MSR_DEFAULT = 0xb0; // dcd, dsr and cts asserted.
+
+    private:
+        /// bytes in [head, head + size) modulo BUFFER_SIZE.
+        struct Ring {
+        public:
+            u8 buffer[BUFFER_SIZE];
+            usize head, size;
+
+            Ring() : head{0}, size{0} {}
+
+            bool full() const { return size == BUFFER_SIZE; }
+
+            void push(u8 val) {
+                buffer[(head + size) % BUFFER_SIZE] = val;
+                ++size;
+            }
+
+            u8 pop() {
+                u8 val = buffer[head];
+                head = (head + 1) % BUFFER_SIZE;
+                --size;
+                return val;
+            }
+
+            /// contiguous bytes from head.
+            usize front_size() const { return head + size > BUFFER_SIZE ? BUFFER_SIZE - head : size; }
+
+            void drop(usize num) {
+                head = (head + num) % BUFFER_SIZE;
+                size -= num;
+            }
+        };
+
+        std::mutex lock;
+        int in_fd, out_fd;
+        Ring tx, rx;
+        u64 tx_since_ns, rx_try_ns;
+        usize dropped;
+        u8 ier, fcr, lcr, mcr, scr, dll, dlm;
+        bool thr_empty_pending;
+        IRQLine irq;
+        bool irq_level;
+        /// flushes output FLUSH_INTERVAL_TICK after the first byte goes into an empty buffer.
+        TimerEvent flush_event;
+        void *timer_hart;
+        void (*flush_scheduler)(void *hart, TimerEvent &event);
+
+        template<typename HartT>
+        static void schedule_flush(void *hart, TimerEvent &event) {
+            HartT *target = static_cast<HartT *>(hart);
+            target->schedule_timer(event, target->get_time() + FLUSH_INTERVAL_TICK);
+        }
+
+        static u64 now_ns() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /// false if the output fd cannot take more bytes now.
+        bool flush_locked() {
+            while (tx.size != 0) {
+                ssize_t ret = ::write(out_fd, tx.buffer + tx.head, tx.front_size());
+                if (ret > 0) {
+                    tx.drop(static_cast<usize>(ret));
+                } else if (ret < 0 && errno == EINTR) {
+                    continue;
+                } else {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        void transmit(u8 val) {
+            if (tx.full() && !flush_locked()) {
+                ++dropped;
+                return;
+            }
+
+            u64 now = now_ns();
+            if (tx.size == 0) {
+                tx_since_ns = now;
+                if (flush_scheduler != nullptr) flush_scheduler(timer_hart, flush_event);
+            }
+            tx.push(val);
+
+            if (val == '\n' || tx.full() || now - tx_since_ns >= FLUSH_INTERVAL_NS) flush_locked();
+            thr_empty_pending = true;
+        }
+
+        void receive() {
+            if (in_fd < 0 || rx.size != 0) return;
+
+            u64 now = now_ns();
+            if (now - rx_try_ns < INPUT_INTERVAL_NS) return;
+            rx_try_ns = now;
+
+            rx.head = 0;
+            ssize_t ret = ::read(in_fd, rx.buffer, BUFFER_SIZE);
+            if (ret > 0) rx.size = static_cast<usize>(ret);
+        }
+
+        u8 get_iir() const {
+            u8 fifo = (fcr & FCR_ENABLE) != 0 ? IIR_FIFO : 0;
+
+            if ((ier & IER_RDI) != 0 && rx.size != 0) return fifo | IIR_RDI;
+            if ((ier & IER_THRI) != 0 && thr_empty_pending) return fifo | IIR_THRI;
+            return fifo | IIR_NO_INT;
+        }
+
+        void update_irq() {
+            bool val = (get_iir() & IIR_NO_INT) == 0;
+            if (val != irq_level) {
+                irq_level = val;
+                irq.set(val);
+            }
+        }
+
+    public:
+        /// in_fd may be -1 for no input. fds are owned by caller.
+        UART(int in_fd, int out_fd) :
+                in_fd{in_fd}, out_fd{out_fd}, tx_since_ns{0}, rx_try_ns{0}, dropped{0},
+                ier{0}, fcr{0}, lcr{0}, mcr{0}, scr{0}, dll{0}, dlm{0}, thr_empty_pending{false},
+                irq{}, irq_level{false}, flush_event{}, timer_hart{nullptr}, flush_scheduler{nullptr} {
+            if (in_fd >= 0) {
+                int flags = fcntl(in_fd, F_GETFL);
+                if (flags < 0 || fcntl(in_fd, F_SETFL, flags | O_NONBLOCK) < 0)
+                    riscv_isa_warn("set uart input non-blocking failed!");
+            }
+
+            // the input interval is not waited for the first read.
+            rx_try_ns = now_ns() - INPUT_INTERVAL_NS;
+        }
+
+        UART(const UART &other) = delete;
+
+        UART &operator=(const UART &other) = delete;
+
+        /// buffered output is flushed by the timer wheel of hart, call before the guest runs. while a flush may be
+        /// pending the uart must not be destroyed before hart.
+        template<typename HartT>
+        void attach(HartT &hart) {
+            flush_event.connect(*this, 0);
+            timer_hart = &hart;
+            flush_scheduler = &schedule_flush<HartT>;
+        }
+
+        /// flush event, called on the thread of the attached hart. a buffer refilled since scheduling is flushed
+        /// early, which only costs a system call.
+        void expire(riscv_isa_unused usize id) {
+            std::lock_guard<std::mutex> guard{lock};
+            flush_locked();
+        }
+
+        /// write buffered output out now.
+        void flush() {
+            std::lock_guard<std::mutex> guard{lock};
+            flush_locked();
+        }
+
+        /// called periodically by host, flushes output older than FLUSH_INTERVAL_NS and reads pending input.
+        void poll() {
+            std::lock_guard<std::mutex> guard{lock};
+
+            if (tx.size != 0 && now_ns() - tx_since_ns >= FLUSH_INTERVAL_NS) flush_locked();
+            receive();
+            update_irq();
+        }
+
+        /// bytes lost because output fd did not take them while the buffer was full.
+        usize get_dropped() {
+            std::lock_guard<std::mutex> guard{lock};
+            return dropped;
+        }
+
+        /// connect before the guest enables interrupts.
+        IRQLine &get_irq_line() { return irq; }
+
+        /// level of the interrupt line.
+        bool get_interrupt() {
+            std::lock_guard<std::mutex> guard{lock};
+            return (get_iir() & IIR_NO_INT) == 0;
+        }
+
+        /// register access by offset from the base of uart, only the low byte is used. false if offset is not mapped.
+
+        bool read(usize offset, u32 &val) {
+            if (offset >= REGISTER_NUM) return false;
+
+            std::lock_guard<std::mutex> guard{lock};
+
+            switch (offset) {
+                case RBR_THR_DLL:
+                    if ((lcr & LCR_DLAB) != 0) {
+                        val = dll;
+                    } else {
+                        receive();
+                        val = rx.size != 0 ? rx.pop() : 0;
+                    }
+                    break;
+                case IER_DLM:
+                    val = (lcr & LCR_DLAB) != 0 ? dlm : ier;
+                    break;
+                case IIR_FCR:
+                    val = get_iir();
+                    // reading iir acknowledges transmitter empty interrupt.
+                    if ((val & 0x0f) == IIR_THRI) thr_empty_pending = false;
+                    break;
+                case LCR:
+                    val = lcr;
+                    break;
+                case MCR:
+                    val = mcr;
+                    break;
+                case LSR:
+                    receive();
+                    val = LSR_THRE | LSR_TEMT | (rx.size != 0 ? LSR_DR : 0);
+                    break;
+                case MSR:
+                    val = MSR_DEFAULT;
+                    break;
+                default:
+                    val = scr;
+                    break;
+            }
+
+            update_irq();
+            return true;
+        }
+
+        bool write(usize offset, u32 val) {
+            if (offset >= REGISTER_NUM) return false;
+
+            std::lock_guard<std::mutex> guard{lock};
+            u8 byte = static_cast<u8>(val);
+
+            switch (offset) {
+                case RBR_THR_DLL:
+                    if ((lcr & LCR_DLAB) != 0) dll = byte;
+                    else transmit(byte);
+                    break;
+                case IER_DLM:
+                    if ((lcr & LCR_DLAB) != 0) {
+                        dlm = byte;
+                    } else {
+                        // enabling transmitter empty interrupt raises it at once, transmitter is always empty.
+                        if ((byte & IER_THRI) != 0 && (ier & IER_THRI) == 0) thr_empty_pending = true;
+                        ier = byte & 0x0f;
+                    }
+                    break;
+                case IIR_FCR:
+                    fcr = byte;
+                    if ((byte & FCR_CLEAR_RCVR) != 0) rx.drop(rx.size);
+                    break;
+                case LCR:
+                    lcr = byte;
+                    break;
+                case MCR:
+                    mcr = byte;
+                    break;
+                case SCR:
+                    scr = byte;
+                    break;
+                default: // lsr and msr are read only.
+                    break;
+            }
+
+            update_irq();
+            return true;
+        }
+
+        ~UART() { flush_locked(); }
+    };
+}
+
+
+#endif //RISCV_ISA_UART_HPP
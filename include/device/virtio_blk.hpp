@@ -0,0 +1,177 @@
+#ifndef RISCV_ISA_VIRTIO_BLK_HPP
+#define RISCV_ISA_VIRTIO_BLK_HPP
+
+
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "riscv_isa_utility.hpp"
+#include "virtio_mmio.hpp"
+
+
+namespace riscv_isa {
+    /// virtio block device with one request queue. the disk image is mapped into host memory, so a request is served
+    /// by copying directly between guest memory and the mapping, and flush is msync of the mapping.
+    ///
+    /// a notification serves every available request, and completion of the batch is published once, on an io
+    /// thread if the transport has a pool.
+    class VirtioBlk : public VirtioMMIO<VirtioBlk, 1> {
+    public:
+        static constexpr u32 DEVICE_ID = 2;
+        static constexpr u64 SECTOR_SIZE = 512;
+        static constexpr usize ID_SIZE = 20;
+
+        static constexpr u64 F_RO = 1ull << 5u;
+        static constexpr u64 F_FLUSH = 1ull << 9u;
+
+        static constexpr u32 T_IN = 0;
+        static constexpr u32 T_OUT = 1;
+        static constexpr u32 T_FLUSH = 4;
+        static constexpr u32 T_GET_ID = 8;
+
+        static constexpr u8 S_OK = 0;
+        static constexpr u8 S_IOERR = 1;
+        static constexpr u8 S_UNSUPP = 2;
+
+        enum : usize {
+            CONFIG_CAPACITY_LOW = CONFIG + 0x0,
+            CONFIG_CAPACITY_HIGH = CONFIG + 0x4,
+        };
+
+    private:
+        struct RequestHeader {
+        public:
+            u32 type;
+            u32 reserved;
+            u64 sector;
+        };
+
+        u8 *image;
+        u64 image_size;
+        bool read_only;
+        std::vector<Virtqueue::Buffer> chain;
+
+        /// copy between guest buffers and image, returns status and adds bytes written to guest memory to len.
+        u8 transfer(const RequestHeader &header, u32 &len) {
+            if (header.sector > image_size / SECTOR_SIZE) return S_IOERR;
+            u64 offset = header.sector * SECTOR_SIZE;
+
+            for (usize i = 1; i + 1 < chain.size(); ++i) {
+                Virtqueue::Buffer &buffer = chain[i];
+                if (buffer.len > image_size - offset) return S_IOERR;
+
+                if (header.type == T_IN) {
+                    if (!buffer.write) return S_IOERR;
+                    memcpy(buffer.ptr, image + offset, buffer.len);
+                    len += buffer.len;
+                } else {
+                    if (buffer.write) return S_IOERR;
+                    if (read_only) return S_IOERR;
+                    memcpy(image + offset, buffer.ptr, buffer.len);
+                }
+
+                offset += buffer.len;
+            }
+
+            return S_OK;
+        }
+
+        /// returns length written to guest memory.
+        u32 serve() {
+            // header first, status byte last, data in between.
+            if (chain.size() < 2 || chain.front().write || chain.front().len < sizeof(RequestHeader) ||
+                !chain.back().write || chain.back().len < 1)
+                return 0;
+
+            RequestHeader header;
+            memcpy(&header, chain.front().ptr, sizeof(header));
+
+            u32 len = 1;
+            u8 result;
+
+            switch (header.type) {
+                case T_IN:
+                case T_OUT:
+                    result = transfer(header, len);
+                    break;
+                case T_GET_ID:
+                    if (chain.size() != 3 || !chain[1].write) {
+                        result = S_IOERR;
+                    } else {
+                        u32 size = chain[1].len < ID_SIZE ? chain[1].len : static_cast<u32>(ID_SIZE);
+                        memset(chain[1].ptr, 0, size);
+                        memcpy(chain[1].ptr, "riscv-isa", size < 9 ? size : 9);
+                        len += size;
+                        result = S_OK;
+                    }
+                    break;
+                case T_FLUSH:
+                    result = read_only || msync(image, image_size, MS_SYNC) == 0 ? S_OK : S_IOERR;
+                    break;
+                default:
+                    result = S_UNSUPP;
+                    break;
+            }
+
+            *chain.back().ptr = result;
+            return len;
+        }
+
+    public:
+        /// image_size is rounded down to whole sectors. image is owned by caller, see map_image.
+        VirtioBlk(const GuestRAM &ram, void *image, u64 image_size, bool read_only) :
+                VirtioMMIO{ram}, image{static_cast<u8 *>(image)}, image_size{image_size / SECTOR_SIZE * SECTOR_SIZE},
+                read_only{read_only} {}
+
+        VirtioBlk(const VirtioBlk &other) = delete;
+
+        VirtioBlk &operator=(const VirtioBlk &other) = delete;
+
+        /// map a disk image file shared, so guest writes reach the file. returns MAP_FAILED on failure, size is set
+        /// to the file size. unmap with munmap.
+        static void *map_image(const char *path, bool read_only, u64 &size) {
+            int fd = open(path, read_only ? O_RDONLY : O_RDWR);
+            if (fd < 0) return MAP_FAILED;
+
+            struct stat info;
+            if (fstat(fd, &info) != 0 || info.st_size == 0) {
+                close(fd);
+                return MAP_FAILED;
+            }
+
+            size = static_cast<u64>(info.st_size);
+            void *image = mmap(nullptr, size, read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+
+            return image;
+        }
+
+        u64 get_features() const { return F_FLUSH | (read_only ? F_RO : 0); }
+
+        bool read_config(usize offset, u32 &val) {
+            if (offset == CONFIG_CAPACITY_LOW - CONFIG) val = static_cast<u32>(image_size / SECTOR_SIZE);
+            else if (offset == CONFIG_CAPACITY_HIGH - CONFIG) val = static_cast<u32>((image_size / SECTOR_SIZE) >> 32u);
+            else return false;
+
+            return true;
+        }
+
+        void process_queue(riscv_isa_unused usize index) {
+            u16 head;
+            bool used = false;
+            while (queues[0].pop(ram, head, chain)) {
+                queues[0].push(head, chain.empty() ? 0 : serve());
+                used = true;
+            }
+
+            if (used) publish(0);
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_VIRTIO_BLK_HPP
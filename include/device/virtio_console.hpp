@@ -0,0 +1,158 @@
+#ifndef RISCV_ISA_VIRTIO_CONSOLE_HPP
+#define RISCV_ISA_VIRTIO_CONSOLE_HPP
+
+
+#include <cerrno>
+#include <vector>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "riscv_isa_utility.hpp"
+#include "virtio_mmio.hpp"
+
+
+namespace riscv_isa {
+    /// virtio console with a single port, receive queue 0 and transmit queue 1. unlike the uart, the guest hands
+    /// over whole buffers, so output costs one doorbell per batch instead of a trap per byte.
+    ///
+    /// every buffer available on the transmit queue at a notification is written out by one writev, however many
+    /// chains they belong to. input is read from the input fd, which is made non-blocking, by one readv straight
+    /// into the buffers of the receive queue, whenever the driver adds receive buffers and whenever the host calls
+    /// poll.
+    class VirtioConsole : public VirtioMMIO<VirtioConsole, 2> {
+    public:
+        static constexpr u32 DEVICE_ID = 3;
+
+        static constexpr usize RECEIVE_QUEUE = 0;
+        static constexpr usize TRANSMIT_QUEUE = 1;
+
+        enum : usize {
+            CONFIG_COLS_ROWS = CONFIG + 0x0,
+            CONFIG_MAX_NR_PORTS = CONFIG + 0x4,
+            CONFIG_EMERG_WR = CONFIG + 0x8,
+        };
+
+    private:
+        int in_fd, out_fd;
+        usize dropped;
+        std::vector<Virtqueue::Buffer> chain;
+        std::vector<iovec> iov;
+        std::vector<u16> heads;
+
+        /// bytes the output fd cannot take now are dropped.
+        void write_out() {
+            usize index = 0;
+
+            while (index < iov.size()) {
+                usize num = iov.size() - index < IOV_MAX ? iov.size() - index : IOV_MAX;
+                ssize_t ret = ::writev(out_fd, iov.data() + index, static_cast<int>(num));
+                if (ret < 0 && errno == EINTR) continue;
+                if (ret <= 0) break;
+
+                // skip what was written, a partial write leaves the rest of a buffer in place.
+                usize written = static_cast<usize>(ret);
+                while (index < iov.size() && written >= iov[index].iov_len) written -= iov[index++].iov_len;
+                if (index < iov.size()) {
+                    iov[index].iov_base = static_cast<u8 *>(iov[index].iov_base) + written;
+                    iov[index].iov_len -= written;
+                }
+            }
+
+            for (; index < iov.size(); ++index) dropped += iov[index].iov_len;
+            iov.clear();
+        }
+
+        void transmit() {
+            Virtqueue &queue = queues[TRANSMIT_QUEUE];
+            u16 head;
+
+            while (queue.pop(ram, head, chain)) {
+                for (auto &buffer: chain) {
+                    if (!buffer.write && buffer.len != 0) iov.push_back(iovec{buffer.ptr, buffer.len});
+                }
+                heads.push_back(head);
+            }
+
+            if (heads.empty()) return;
+
+            write_out();
+
+            for (u16 used_head: heads) queue.push(used_head, 0);
+            heads.clear();
+            publish(TRANSMIT_QUEUE);
+        }
+
+        void receive() {
+            Virtqueue &queue = queues[RECEIVE_QUEUE];
+            if (in_fd < 0) return;
+
+            u16 head;
+            bool used = false;
+
+            // one read per chain, a chain is given back if there is no input for it.
+            while (queue.pop(ram, head, chain)) {
+                for (auto &buffer: chain) {
+                    if (buffer.write && buffer.len != 0) iov.push_back(iovec{buffer.ptr, buffer.len});
+                }
+
+                bool writable = !iov.empty();
+                ssize_t ret;
+                do {
+                    ret = writable ? ::readv(in_fd, iov.data(), static_cast<int>(iov.size())) : 0;
+                } while (ret < 0 && errno == EINTR);
+                iov.clear();
+
+                if (ret <= 0 && writable) {
+                    queue.unpop();
+                    break;
+                }
+
+                queue.push(head, ret > 0 ? static_cast<u32>(ret) : 0);
+                used = true;
+            }
+
+            if (used) publish(RECEIVE_QUEUE);
+        }
+
+    public:
+        /// in_fd may be -1 for no input. fds are owned by caller.
+        VirtioConsole(const GuestRAM &ram, int in_fd, int out_fd) :
+                VirtioMMIO{ram}, in_fd{in_fd}, out_fd{out_fd}, dropped{0} {
+            if (in_fd >= 0) {
+                int flags = fcntl(in_fd, F_GETFL);
+                if (flags < 0 || fcntl(in_fd, F_SETFL, flags | O_NONBLOCK) < 0)
+                    riscv_isa_warn("set console input non-blocking failed!");
+            }
+        }
+
+        /// called periodically by host to deliver pending input.
+        void poll() { notify(RECEIVE_QUEUE); }
+
+        /// bytes lost because output fd did not take them.
+        usize get_dropped() {
+            std::lock_guard<std::mutex> guard{io_lock};
+            return dropped;
+        }
+
+        u64 get_features() const { return 0; }
+
+        bool read_config(usize offset, u32 &val) {
+            if (offset == CONFIG_COLS_ROWS - CONFIG) val = 80u | 25u << 16u;
+            else if (offset == CONFIG_MAX_NR_PORTS - CONFIG) val = 1;
+            else if (offset == CONFIG_EMERG_WR - CONFIG) val = 0;
+            else return false;
+
+            return true;
+        }
+
+        void process_queue(usize index) {
+            if (index == TRANSMIT_QUEUE) transmit();
+            else receive();
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_VIRTIO_CONSOLE_HPP
@@ -0,0 +1,320 @@
+#ifndef RISCV_ISA_VIRTIO_MMIO_HPP
+#define RISCV_ISA_VIRTIO_MMIO_HPP
+
+
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+
+#include "riscv_isa_utility.hpp"
+#include "virtqueue.hpp"
+#include "irq_line.hpp"
+#include "io_thread_pool.hpp"
+
+
+namespace riscv_isa {
+    /// virtio-mmio transport, version 2, shared by every virtio device. it owns the registers, the feature
+    /// negotiation, VIRTQUEUE_NUM queues, notification and the interrupt, SubT only serves its queues and config
+    /// space. SubT is required to implement:
+    ///
+    ///     static constexpr u32 DEVICE_ID;
+    ///
+    ///     /// device specific feature bits, VERSION_1 and EVENT_IDX are added by the transport.
+    ///     u64 get_features() const;
+    ///
+    ///     /// word at offset of config space, which is a multiple of 4. false if offset is not mapped.
+    ///     bool read_config(usize offset, u32 &val);
+    ///
+    ///     /// serve queue index. called with io_lock held, on an io thread if there is a pool.
+    ///     void process_queue(usize index);
+    ///
+    /// a doorbell marks its queue notified and processes the device, or posts it to the io thread pool if there is
+    /// one, so the notifying hart continues at once. doorbells arriving while the device is posted are coalesced,
+    /// and each queue notified meanwhile is served once. a batch of used buffers is published with one store to the
+    /// used ring, and raises the interrupt at most once, or not at all if the driver suppressed it.
+    ///
+    /// lock guards registers, io_lock guards the queues and is held while serving them, so registers not touching
+    /// the queues never wait for io. io_lock is always taken first.
+    template<typename SubT, usize VIRTQUEUE_NUM>
+    class VirtioMMIO {
+    public:
+        static constexpr u32 MAGIC = 0x74726976; // "virt"
+        static constexpr u32 VERSION = 2;
+        static constexpr u32 VENDOR_ID = 0x554d4551; // "QEMU"
+        static constexpr u16 QUEUE_NUM_MAX = 256;
+
+        static constexpr u64 F_EVENT_IDX = 1ull << 29u;
+        static constexpr u64 F_VERSION_1 = 1ull << 32u;
+
+        static constexpr u32 INTERRUPT_USED_BUFFER = 1;
+        static constexpr u32 STATUS_DRIVER_OK = 4;
+
+        enum : usize {
+            MAGIC_VALUE = 0x000,
+            VERSION_REG = 0x004,
+            DEVICE_ID_REG = 0x008,
+            VENDOR_ID_REG = 0x00c,
+            DEVICE_FEATURES = 0x010,
+            DEVICE_FEATURES_SEL = 0x014,
+            DRIVER_FEATURES = 0x020,
+            DRIVER_FEATURES_SEL = 0x024,
+            QUEUE_SEL = 0x030,
+            QUEUE_NUM_MAX_REG = 0x034,
+            QUEUE_NUM = 0x038,
+            QUEUE_READY = 0x044,
+            QUEUE_NOTIFY = 0x050,
+            INTERRUPT_STATUS = 0x060,
+            INTERRUPT_ACK = 0x064,
+            STATUS = 0x070,
+            QUEUE_DESC_LOW = 0x080,
+            QUEUE_DESC_HIGH = 0x084,
+            QUEUE_DRIVER_LOW = 0x090,
+            QUEUE_DRIVER_HIGH = 0x094,
+            QUEUE_DEVICE_LOW = 0x0a0,
+            QUEUE_DEVICE_HIGH = 0x0a4,
+            CONFIG_GENERATION = 0x0fc,
+            CONFIG = 0x100,
+        };
+
+        static_assert(VIRTQUEUE_NUM > 0 && VIRTQUEUE_NUM <= 32, "notified queues are kept in one word");
+
+    private:
+        IOThreadPool *pool;
+        IRQLine irq;
+        std::atomic<bool> scheduled;
+        std::atomic<u32> notified;
+
+        u64 driver_features;
+        u32 device_features_sel, driver_features_sel, queue_sel;
+        u32 status, interrupt_status;
+
+        SubT *sub_type() {
+            static_assert(std::is_base_of<VirtioMMIO, SubT>::value, "not subtype of virtio mmio");
+
+            return static_cast<SubT *>(this);
+        }
+
+        u64 get_device_features() { return F_VERSION_1 | F_EVENT_IDX | sub_type()->get_features(); }
+
+        static void set_low(u64 &reg, u32 val) { reg = (reg & ~0xffffffffull) | val; }
+
+        static void set_high(u64 &reg, u32 val) { reg = (reg & 0xffffffffull) | static_cast<u64>(val) << 32u; }
+
+        void reset() {
+            notified.store(0, std::memory_order_relaxed);
+            driver_features = 0;
+            device_features_sel = 0;
+            driver_features_sel = 0;
+            queue_sel = 0;
+            status = 0;
+            interrupt_status = 0;
+            for (auto &queue: queues) queue.reset();
+            irq.set(false);
+        }
+
+        /// queue selected by queue_sel, nullptr if it does not exist.
+        Virtqueue *get_selected() { return queue_sel < VIRTQUEUE_NUM ? &queues[queue_sel] : nullptr; }
+
+        static bool is_queue_register(usize offset) {
+            return offset == QUEUE_NUM || offset == QUEUE_READY || offset == STATUS ||
+                   (offset >= QUEUE_DESC_LOW && offset <= QUEUE_DEVICE_HIGH);
+        }
+
+    protected:
+        std::mutex lock, io_lock;
+        GuestRAM ram;
+        Virtqueue queues[VIRTQUEUE_NUM];
+
+        /// make buffers pushed to queue index visible to the driver, and raise the interrupt if it wants one. called
+        /// with io_lock held.
+        void publish(usize index) {
+            if (queues[index].publish()) {
+                std::lock_guard<std::mutex> guard{lock};
+                interrupt_status |= INTERRUPT_USED_BUFFER;
+                irq.set(true);
+            }
+        }
+
+    public:
+        explicit VirtioMMIO(const GuestRAM &ram) :
+                pool{nullptr}, irq{}, scheduled{false}, notified{0}, ram{ram} { reset(); }
+
+        VirtioMMIO(const VirtioMMIO &other) = delete;
+
+        VirtioMMIO &operator=(const VirtioMMIO &other) = delete;
+
+        /// serve queues on threads of pool instead of the notifying hart, nullptr to serve them inline. set before
+        /// the driver starts, pool must be idle before device is destroyed.
+        void set_io_pool(IOThreadPool *io_pool) { pool = io_pool; }
+
+        /// connect before the driver starts.
+        IRQLine &get_irq_line() { return irq; }
+
+        /// level of the interrupt line.
+        bool get_interrupt() {
+            std::lock_guard<std::mutex> guard{lock};
+            return interrupt_status != 0;
+        }
+
+        /// serve queue index as if the driver notified it, used by devices with input from host.
+        void notify(usize index) {
+            notified.fetch_or(1u << index, std::memory_order_acq_rel);
+
+            if (pool == nullptr) {
+                process();
+            } else if (!scheduled.exchange(true, std::memory_order_acq_rel)) {
+                pool->post(*sub_type());
+            }
+        }
+
+        /// serve every queue notified. called by io thread, or by notify if there is no pool.
+        void process() {
+            scheduled.store(false, std::memory_order_release);
+
+            std::lock_guard<std::mutex> io_guard{io_lock};
+            {
+                std::lock_guard<std::mutex> guard{lock};
+                if ((status & STATUS_DRIVER_OK) == 0) return;
+            }
+
+            u32 pending = notified.exchange(0, std::memory_order_acq_rel);
+            for (usize i = 0; i < VIRTQUEUE_NUM; ++i) {
+                if ((pending & (1u << i)) != 0 && queues[i].is_ready()) sub_type()->process_queue(i);
+            }
+        }
+
+        /// register access by offset from the base of device. config space may be accessed at any byte offset,
+        /// other registers only as words. false if offset is not mapped.
+
+        bool read(usize offset, u32 &val) {
+            std::lock_guard<std::mutex> guard{lock};
+
+            if (offset >= CONFIG) {
+                usize shift = offset % sizeof(u32) * 8;
+                if (!sub_type()->read_config(offset - CONFIG - offset % sizeof(u32), val)) return false;
+                val >>= shift;
+                return true;
+            }
+
+            if (offset % sizeof(u32) != 0) return false;
+            Virtqueue *queue = get_selected();
+
+            switch (offset) {
+                case MAGIC_VALUE:
+                    val = MAGIC;
+                    break;
+                case VERSION_REG:
+                    val = VERSION;
+                    break;
+                case DEVICE_ID_REG:
+                    val = SubT::DEVICE_ID;
+                    break;
+                case VENDOR_ID_REG:
+                    val = VENDOR_ID;
+                    break;
+                case DEVICE_FEATURES:
+                    val = device_features_sel == 0 ? static_cast<u32>(get_device_features()) :
+                          device_features_sel == 1 ? static_cast<u32>(get_device_features() >> 32u) : 0;
+                    break;
+                case QUEUE_NUM_MAX_REG:
+                    val = queue != nullptr ? QUEUE_NUM_MAX : 0;
+                    break;
+                case QUEUE_READY:
+                    val = queue != nullptr && queue->is_ready() ? 1 : 0;
+                    break;
+                case INTERRUPT_STATUS:
+                    val = interrupt_status;
+                    break;
+                case STATUS:
+                    val = status;
+                    break;
+                case CONFIG_GENERATION:
+                    val = 0;
+                    break;
+                default:
+                    val = 0;
+                    break;
+            }
+
+            return true;
+        }
+
+        bool write(usize offset, u32 val) {
+            if (offset >= CONFIG) return true; // config space is read only.
+            if (offset % sizeof(u32) != 0) return false;
+
+            if (offset == QUEUE_NOTIFY) {
+                if (val < VIRTQUEUE_NUM) notify(val);
+                return true;
+            }
+
+            std::unique_lock<std::mutex> io_guard{io_lock, std::defer_lock};
+            if (is_queue_register(offset)) io_guard.lock();
+            std::lock_guard<std::mutex> guard{lock};
+            Virtqueue *queue = get_selected();
+
+            switch (offset) {
+                case DEVICE_FEATURES_SEL:
+                    device_features_sel = val;
+                    break;
+                case DRIVER_FEATURES:
+                    if (driver_features_sel == 0) set_low(driver_features, val);
+                    else if (driver_features_sel == 1) set_high(driver_features, val);
+                    break;
+                case DRIVER_FEATURES_SEL:
+                    driver_features_sel = val;
+                    break;
+                case QUEUE_SEL:
+                    queue_sel = val;
+                    break;
+                case INTERRUPT_ACK:
+                    interrupt_status &= ~val;
+                    if (interrupt_status == 0) irq.set(false);
+                    break;
+                case STATUS:
+                    if (val == 0) reset();
+                    else status = val;
+                    break;
+                default:
+                    break;
+            }
+
+            if (queue == nullptr) return true;
+
+            switch (offset) {
+                case QUEUE_NUM:
+                    if (val <= QUEUE_NUM_MAX) queue->num = static_cast<u16>(val);
+                    break;
+                case QUEUE_READY:
+                    if (val == 0) queue->reset();
+                    else queue->enable(ram, (driver_features & F_EVENT_IDX) != 0);
+                    break;
+                case QUEUE_DESC_LOW:
+                    set_low(queue->desc_addr, val);
+                    break;
+                case QUEUE_DESC_HIGH:
+                    set_high(queue->desc_addr, val);
+                    break;
+                case QUEUE_DRIVER_LOW:
+                    set_low(queue->avail_addr, val);
+                    break;
+                case QUEUE_DRIVER_HIGH:
+                    set_high(queue->avail_addr, val);
+                    break;
+                case QUEUE_DEVICE_LOW:
+                    set_low(queue->used_addr, val);
+                    break;
+                case QUEUE_DEVICE_HIGH:
+                    set_high(queue->used_addr, val);
+                    break;
+                default: // read only registers.
+                    break;
+            }
+
+            return true;
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_VIRTIO_MMIO_HPP
@@ -0,0 +1,219 @@
+#ifndef RISCV_ISA_VIRTIO_NET_HPP
+#define RISCV_ISA_VIRTIO_NET_HPP
+
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "riscv_isa_utility.hpp"
+#include "virtio_mmio.hpp"
+
+
+namespace riscv_isa {
+    /// virtio network device, receive queue 0 and transmit queue 1, with a datagram socket as the wire. a
+    /// datagram carries one ethernet frame, so two devices on the ends of make_link are two machines on one
+    /// segment with no tap device or host network involved.
+    ///
+    /// every frame available on the transmit queue at a notification goes out by one sendmmsg, and receive buffers
+    /// are filled by one recvmmsg per BATCH chains, straight from and into guest memory. frames are received
+    /// whenever the driver adds receive buffers and whenever the host calls poll. frames the socket cannot take,
+    /// and frames longer than their receive buffers, are dropped as a wire would.
+    class VirtioNet : public VirtioMMIO<VirtioNet, 2> {
+    public:
+        static constexpr u32 DEVICE_ID = 1;
+
+        static constexpr usize RECEIVE_QUEUE = 0;
+        static constexpr usize TRANSMIT_QUEUE = 1;
+
+        static constexpr u64 F_MAC = 1ull << 5u;
+        static constexpr u64 F_STATUS = 1ull << 16u;
+        static constexpr u16 S_LINK_UP = 1;
+
+        /// virtio_net_hdr of virtio 1.x, num_buffers is always there.
+        static constexpr usize HEADER_SIZE = 12;
+        static constexpr usize MAC_SIZE = 6;
+        static constexpr usize BATCH = 64;
+        /// most messages one sendmmsg takes, UIO_MAXIOV of the kernel.
+        static constexpr usize SEND_MAX = 1024;
+
+        enum : usize {
+            CONFIG_MAC = CONFIG + 0x0,
+            CONFIG_STATUS = CONFIG + 0x6,
+        };
+
+    private:
+        /// one frame, header and data pieces are ranges of headers and iov.
+        struct Message {
+        public:
+            u16 head;
+            usize header_begin, header_end;
+            usize iov_begin, iov_end;
+        };
+
+        int fd;
+        u8 mac[MAC_SIZE];
+        usize dropped;
+        std::vector<Virtqueue::Buffer> chain;
+        std::vector<Message> messages;
+        std::vector<iovec> headers, iov;
+        std::vector<mmsghdr> msgs;
+
+        /// split buffers of chain in direction write into header and data pieces.
+        void add_message(u16 head, bool write) {
+            Message message{head, headers.size(), 0, iov.size(), 0};
+            usize skip = HEADER_SIZE;
+
+            for (auto &buffer: chain) {
+                if (buffer.write != write || buffer.len == 0) continue;
+
+                usize header_len = skip < buffer.len ? skip : buffer.len;
+                if (header_len != 0) headers.push_back(iovec{buffer.ptr, header_len});
+                skip -= header_len;
+
+                if (buffer.len > header_len) iov.push_back(iovec{buffer.ptr + header_len, buffer.len - header_len});
+            }
+
+            message.header_end = headers.size();
+            message.iov_end = iov.size();
+            messages.push_back(message);
+        }
+
+        /// msgs pointing into iov, built once every message is added, since iov may move while it grows.
+        void build_msgs() {
+            msgs.resize(messages.size());
+
+            for (usize i = 0; i < messages.size(); ++i) {
+                memset(&msgs[i], 0, sizeof(mmsghdr));
+                msgs[i].msg_hdr.msg_iov = iov.data() + messages[i].iov_begin;
+                msgs[i].msg_hdr.msg_iovlen = messages[i].iov_end - messages[i].iov_begin;
+            }
+        }
+
+        void clear() {
+            messages.clear();
+            headers.clear();
+            iov.clear();
+        }
+
+        /// header of a received frame, no offload and one buffer. returns bytes written.
+        u32 write_header(const Message &message) {
+            u8 header[HEADER_SIZE] = {};
+            header[10] = 1; // num_buffers
+
+            usize done = 0;
+            for (usize i = message.header_begin; i < message.header_end; ++i) {
+                memcpy(headers[i].iov_base, header + done, headers[i].iov_len);
+                done += headers[i].iov_len;
+            }
+
+            return static_cast<u32>(done);
+        }
+
+        void transmit() {
+            Virtqueue &queue = queues[TRANSMIT_QUEUE];
+            u16 head;
+
+            while (queue.pop(ram, head, chain)) add_message(head, false);
+            if (messages.empty()) return;
+
+            build_msgs();
+            for (usize sent = 0; sent < msgs.size();) {
+                usize num = msgs.size() - sent < SEND_MAX ? msgs.size() - sent : SEND_MAX;
+                int ret = fd < 0 ? -1 : sendmmsg(fd, msgs.data() + sent, static_cast<unsigned>(num), MSG_DONTWAIT);
+                if (ret < 0 && errno == EINTR) continue;
+                if (ret <= 0) {
+                    dropped += msgs.size() - sent;
+                    break;
+                }
+
+                sent += static_cast<usize>(ret);
+            }
+
+            for (auto &message: messages) queue.push(message.head, 0);
+            clear();
+            publish(TRANSMIT_QUEUE);
+        }
+
+        void receive() {
+            Virtqueue &queue = queues[RECEIVE_QUEUE];
+            if (fd < 0) return;
+
+            bool used = false;
+
+            for (;;) {
+                u16 head;
+                while (messages.size() < BATCH && queue.pop(ram, head, chain)) add_message(head, true);
+                if (messages.empty()) break;
+
+                build_msgs();
+                int ret;
+                do {
+                    ret = recvmmsg(fd, msgs.data(), static_cast<unsigned>(msgs.size()), MSG_DONTWAIT, nullptr);
+                } while (ret < 0 && errno == EINTR);
+
+                // chains with no frame for them are given back, a truncated frame is dropped by using its chain
+                // with no data, which the driver discards as too short.
+                usize received = ret > 0 ? static_cast<usize>(ret) : 0;
+                for (usize i = 0; i < received; ++i) {
+                    if ((msgs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0) {
+                        ++dropped;
+                        queue.push(messages[i].head, 0);
+                    } else {
+                        queue.push(messages[i].head, write_header(messages[i]) + msgs[i].msg_len);
+                    }
+                    used = true;
+                }
+                queue.unpop(static_cast<u16>(messages.size() - received));
+
+                bool more = received == messages.size();
+                clear();
+                if (!more) break;
+            }
+
+            if (used) publish(RECEIVE_QUEUE);
+        }
+
+    public:
+        /// connected pair of datagram sockets, one for each of two devices. fds are owned by caller.
+        static bool make_link(int fds[2]) { return socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, fds) == 0; }
+
+        /// fd is a connected datagram socket owned by caller, -1 for a device with no wire.
+        VirtioNet(const GuestRAM &ram, int fd, const u8 *mac_addr) : VirtioMMIO{ram}, fd{fd}, mac{}, dropped{0} {
+            memcpy(mac, mac_addr, MAC_SIZE);
+        }
+
+        /// called periodically by host to deliver pending frames.
+        void poll() { notify(RECEIVE_QUEUE); }
+
+        /// frames lost because the socket did not take them, or truncated by short receive buffers.
+        usize get_dropped() {
+            std::lock_guard<std::mutex> guard{io_lock};
+            return dropped;
+        }
+
+        u64 get_features() const { return F_MAC | F_STATUS; }
+
+        bool read_config(usize offset, u32 &val) {
+            if (offset == CONFIG_MAC - CONFIG) {
+                val = mac[0] | mac[1] << 8u | mac[2] << 16u | static_cast<u32>(mac[3]) << 24u;
+            } else if (offset == CONFIG_MAC + 4 - CONFIG) {
+                val = mac[4] | mac[5] << 8u | static_cast<u32>(S_LINK_UP) << 16u;
+            } else {
+                return false;
+            }
+
+            return true;
+        }
+
+        void process_queue(usize index) {
+            if (index == TRANSMIT_QUEUE) transmit();
+            else receive();
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_VIRTIO_NET_HPP
@@ -0,0 +1,69 @@
+#ifndef RISCV_ISA_VIRTIO_RNG_HPP
+#define RISCV_ISA_VIRTIO_RNG_HPP
+
+
+#include <cerrno>
+#include <vector>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "riscv_isa_utility.hpp"
+#include "virtio_mmio.hpp"
+
+
+namespace riscv_isa {
+    /// virtio entropy device with one request queue. every writable buffer is filled by getrandom of the host
+    /// directly in guest memory, a guest asking for a page of entropy costs one doorbell.
+    class VirtioRNG : public VirtioMMIO<VirtioRNG, 1> {
+    public:
+        static constexpr u32 DEVICE_ID = 4;
+
+    private:
+        std::vector<Virtqueue::Buffer> chain;
+
+        /// returns bytes filled, which stops at the first buffer getrandom cannot fill.
+        static u32 fill(Virtqueue::Buffer &buffer) {
+            u32 done = 0;
+
+            while (done < buffer.len) {
+                long ret = syscall(SYS_getrandom, buffer.ptr + done, buffer.len - done, 0);
+                if (ret < 0 && errno == EINTR) continue;
+                if (ret <= 0) break;
+                done += static_cast<u32>(ret);
+            }
+
+            return done;
+        }
+
+    public:
+        explicit VirtioRNG(const GuestRAM &ram) : VirtioMMIO{ram} {}
+
+        u64 get_features() const { return 0; }
+
+        bool read_config(riscv_isa_unused usize offset, riscv_isa_unused u32 &val) { return false; }
+
+        void process_queue(riscv_isa_unused usize index) {
+            u16 head;
+            bool used = false;
+
+            while (queues[0].pop(ram, head, chain)) {
+                u32 len = 0;
+                for (auto &buffer: chain) {
+                    if (!buffer.write) continue;
+
+                    u32 done = fill(buffer);
+                    len += done;
+                    if (done != buffer.len) break;
+                }
+
+                queues[0].push(head, len);
+                used = true;
+            }
+
+            if (used) publish(0);
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_VIRTIO_RNG_HPP
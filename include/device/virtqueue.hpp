@@ -0,0 +1,177 @@
+#ifndef RISCV_ISA_VIRTQUEUE_HPP
+#define RISCV_ISA_VIRTQUEUE_HPP
+
+
+#include <vector>
+
+#include "riscv_isa_utility.hpp"
+#include "guest_atomic.hpp"
+
+
+namespace riscv_isa {
+    /// guest physical memory seen by a device, one contiguous range backed by host memory. the host must be little
+    /// endian, as every virtio structure is.
+    class GuestRAM {
+    private:
+        u8 *host;
+        u64 base, size;
+
+    public:
+        GuestRAM(void *host, u64 base, u64 size) : host{static_cast<u8 *>(host)}, base{base}, size{size} {}
+
+        /// host address of [addr, addr + length), nullptr if any byte of it is outside.
+        u8 *get(u64 addr, u64 length) const {
+            u64 offset = addr - base;
+            return offset < size && length <= size - offset ? host + offset : nullptr;
+        }
+    };
+
+    /// split virtqueue of virtio 1.x, processed by the device side. the driver owns descriptors and the available
+    /// ring, device owns the used ring.
+    ///
+    /// used elements are written by push and only become visible to the driver on publish, so a batch of requests
+    /// handled for one notification is published with a single release store, and needs at most one interrupt.
+    ///
+    /// with event idx negotiated, the driver asks for an interrupt only once the used index passes used_event, and
+    /// the device asks for a notification only once the available index passes avail_event, which is kept at the
+    /// last available index seen, so a driver adding buffers while the device is still serving does not notify.
+    class Virtqueue {
+    public:
+        static constexpr u16 DESC_F_NEXT = 1;
+        static constexpr u16 DESC_F_WRITE = 2;
+        static constexpr u16 AVAIL_F_NO_INTERRUPT = 1;
+
+        /// one descriptor of a chain, resolved to host memory.
+        struct Buffer {
+        public:
+            u8 *ptr;
+            u32 len;
+            bool write;
+        };
+
+    private:
+        struct Desc {
+        public:
+            u64 addr;
+            u32 len;
+            u16 flags;
+            u16 next;
+        };
+
+        struct UsedElem {
+        public:
+            u32 id;
+            u32 len;
+        };
+
+        Desc *desc;
+        u16 *avail; // flags, idx, ring[num], used_event
+        u16 *used; // flags, idx, then UsedElem ring[num], avail_event
+        u16 last_avail_idx, used_idx, published_idx;
+        bool event_idx;
+
+        u16 *get_avail_event() { return used + 2 + num * sizeof(UsedElem) / sizeof(u16); }
+
+        bool is_avail_empty() { return guest_atomic::load(avail + 1, std::memory_order_acquire) == last_avail_idx; }
+
+    public:
+        u16 num;
+        u64 desc_addr, avail_addr, used_addr;
+
+        Virtqueue() : desc{nullptr}, avail{nullptr}, used{nullptr}, last_avail_idx{0}, used_idx{0}, published_idx{0},
+                      event_idx{false}, num{0}, desc_addr{0}, avail_addr{0}, used_addr{0} {}
+
+        bool is_ready() const { return desc != nullptr; }
+
+        /// resolve rings set by driver, false if they are not in guest memory. use_event_idx if the driver
+        /// negotiated event idx.
+        bool enable(const GuestRAM &ram, bool use_event_idx = false) {
+            if (num == 0 || (num & (num - 1u)) != 0) return false;
+
+            desc = reinterpret_cast<Desc *>(ram.get(desc_addr, sizeof(Desc) * num));
+            avail = reinterpret_cast<u16 *>(ram.get(avail_addr, sizeof(u16) * (3 + num)));
+            used = reinterpret_cast<u16 *>(ram.get(used_addr, sizeof(u16) * 3 + sizeof(UsedElem) * num));
+            if (desc == nullptr || avail == nullptr || used == nullptr) {
+                reset();
+                return false;
+            }
+
+            event_idx = use_event_idx;
+            return true;
+        }
+
+        void reset() {
+            desc = nullptr;
+            avail = nullptr;
+            used = nullptr;
+            last_avail_idx = 0;
+            used_idx = 0;
+            published_idx = 0;
+            event_idx = false;
+            num = 0;
+            desc_addr = 0;
+            avail_addr = 0;
+            used_addr = 0;
+        }
+
+        /// take the next available chain into chain, returns its head index. false if there is none. a chain which
+        /// is malformed or leaves guest memory comes back empty, and should be pushed with length 0.
+        bool pop(const GuestRAM &ram, u16 &head, std::vector<Buffer> &chain) {
+            if (!is_ready()) return false;
+
+            if (is_avail_empty()) {
+                if (!event_idx) return false;
+
+                // ask for a notification of the next buffer, then check again for one added before the driver saw it.
+                guest_atomic::store(get_avail_event(), last_avail_idx, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (is_avail_empty()) return false;
+            }
+
+            head = avail[2 + last_avail_idx % num];
+            ++last_avail_idx;
+            chain.clear();
+
+            u16 index = head;
+            for (usize i = 0; i < num && index < num; ++i) {
+                Desc &d = desc[index];
+                u8 *ptr = ram.get(d.addr, d.len);
+                if (ptr == nullptr) break;
+
+                chain.push_back(Buffer{ptr, d.len, (d.flags & DESC_F_WRITE) != 0});
+                if ((d.flags & DESC_F_NEXT) == 0) return true;
+                index = d.next;
+            }
+
+            chain.clear();
+            return true;
+        }
+
+        /// give back the last count chains taken by pop, next pops take them again in the same order.
+        void unpop(u16 count = 1) { last_avail_idx -= count; }
+
+        void push(u16 head, u32 len) {
+            UsedElem *ring = reinterpret_cast<UsedElem *>(used + 2);
+            ring[used_idx % num] = UsedElem{head, len};
+            ++used_idx;
+        }
+
+        /// make pushed elements visible, true if the driver wants an interrupt for them.
+        bool publish() {
+            u16 old = published_idx;
+            published_idx = used_idx;
+
+            guest_atomic::store(used + 1, used_idx, std::memory_order_release);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (!event_idx) return (guest_atomic::load(avail, std::memory_order_relaxed) & AVAIL_F_NO_INTERRUPT) == 0;
+
+            // interrupt if used_event is in [old, used_idx), modulo 2^16.
+            u16 event = guest_atomic::load(avail + 2 + num, std::memory_order_relaxed);
+            return static_cast<u16>(used_idx - event - 1) < static_cast<u16>(used_idx - old);
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_VIRTQUEUE_HPP
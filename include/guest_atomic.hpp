@@ -0,0 +1,88 @@
+#ifndef RISCV_ISA_GUEST_ATOMIC_HPP
+#define RISCV_ISA_GUEST_ATOMIC_HPP
+
+
+#include <atomic>
+
+#include "riscv_isa_utility.hpp"
+
+
+namespace riscv_isa {
+    /// atomic access to plain guest memory through the __atomic builtins, the same instructions std::atomic compiles
+    /// to, without pretending guest bytes are std::atomic objects. any naturally aligned pointer returned by
+    /// address_load or address_store works, whatever backs it.
+    ///
+    /// ordinary loads and stores go through load and store with relaxed order, which costs nothing over a plain
+    /// access on common hosts but keeps concurrent harts free of data races.
+    namespace guest_atomic {
+        riscv_isa_static_inline int builtin_order(std::memory_order order) {
+            switch (order) {
+                case std::memory_order_relaxed:
+                    return __ATOMIC_RELAXED;
+                case std::memory_order_consume:
+                    return __ATOMIC_CONSUME;
+                case std::memory_order_acquire:
+                    return __ATOMIC_ACQUIRE;
+                case std::memory_order_release:
+                    return __ATOMIC_RELEASE;
+                case std::memory_order_acq_rel:
+                    return __ATOMIC_ACQ_REL;
+                default:
+                    return __ATOMIC_SEQ_CST;
+            }
+        }
+
+        template<typename ValT>
+        riscv_isa_static_inline ValT load(const ValT *ptr, std::memory_order order = std::memory_order_relaxed) {
+            return __atomic_load_n(ptr, builtin_order(order));
+        }
+
+        template<typename ValT>
+        riscv_isa_static_inline void store(ValT *ptr, ValT val, std::memory_order order = std::memory_order_relaxed) {
+            __atomic_store_n(ptr, val, builtin_order(order));
+        }
+
+        template<typename ValT>
+        riscv_isa_static_inline ValT exchange(ValT *ptr, ValT val, std::memory_order order) {
+            return __atomic_exchange_n(ptr, val, builtin_order(order));
+        }
+
+        template<typename ValT>
+        riscv_isa_static_inline ValT fetch_add(ValT *ptr, ValT val, std::memory_order order) {
+            return __atomic_fetch_add(ptr, val, builtin_order(order));
+        }
+
+        template<typename ValT>
+        riscv_isa_static_inline ValT fetch_and(ValT *ptr, ValT val, std::memory_order order) {
+            return __atomic_fetch_and(ptr, val, builtin_order(order));
+        }
+
+        template<typename ValT>
+        riscv_isa_static_inline ValT fetch_or(ValT *ptr, ValT val, std::memory_order order) {
+            return __atomic_fetch_or(ptr, val, builtin_order(order));
+        }
+
+        template<typename ValT>
+        riscv_isa_static_inline ValT fetch_xor(ValT *ptr, ValT val, std::memory_order order) {
+            return __atomic_fetch_xor(ptr, val, builtin_order(order));
+        }
+
+        /// on failure expected is updated to the current value. failure must not be release or acq_rel.
+        template<typename ValT>
+        riscv_isa_static_inline bool compare_exchange_weak(ValT *ptr, ValT &expected, ValT val,
+                                                           std::memory_order success, std::memory_order failure) {
+            return __atomic_compare_exchange_n(ptr, &expected, val, true, builtin_order(success),
+                                               builtin_order(failure));
+        }
+
+        template<typename ValT>
+        riscv_isa_static_inline bool compare_exchange_strong(ValT *ptr, ValT &expected, ValT val,
+                                                             std::memory_order success, std::memory_order failure) {
+            return __atomic_compare_exchange_n(ptr, &expected, val, false, builtin_order(success),
+                                               builtin_order(failure));
+        }
+    }
+}
+
+
+#endif //RISCV_ISA_GUEST_ATOMIC_HPP
@@ -431,7 +431,7 @@ namespace riscv_isa {
 
     class InstructionArithRegWSet : public InstructionR {
     protected:
-        InstructionArithRegWSet(UInnerT rd, usizUInnerTct3, UInnerT rs1, UInnerT rs2, UInnerT funct7)
+        InstructionArithRegWSet(UInnerT rd, UInnerT funct3, UInnerT rs1, UInnerT rs2, UInnerT funct7)
                 : InstructionR{OP_CODE, rd, funct3, rs1, rs2, funct7} {}
 
     public:
@@ -10,6 +10,7 @@
 #include "rv32a.hpp"
 #include "rv64i.hpp"
 #include "rv64m.hpp"
+#include "rv64a.hpp"
 #include "zifencei.hpp"
 #include "zicsr.hpp"
 #include "privileged_instruction.hpp"
@@ -22,6 +23,7 @@
     riscv_isa_instruction_32a_map(func) \
     riscv_isa_instruction_64i_map(func) \
     riscv_isa_instruction_64m_map(func) \
+    riscv_isa_instruction_64a_map(func) \
     riscv_isa_instruction_zifencei_map(func) \
     riscv_isa_instruction_zicsr_map(func) \
     riscv_isa_instruction_privilege_map(func)
@@ -585,6 +587,18 @@ namespace riscv_isa {
                         default:
                             return sub_type()->illegal_instruction(inst);
                     }
+#if __RV_BIT_WIDTH__ == 64
+                case InstructionAtomicDSet::FUNCT3:
+                    switch (inst->get_funct_atomic()) {
+#define _riscv_isa_visit_64a_instruction(NAME, name) \
+                        case NAME##Inst::FUNCT_ATOMIC: \
+                            return sub_type()->visit_##name##_inst(reinterpret_cast<const NAME##Inst *>(inst));
+                        riscv_isa_instruction_64a_map(_riscv_isa_visit_64a_instruction)
+#undef _riscv_isa_visit_64a_instruction
+                        default:
+                            return sub_type()->illegal_instruction(inst);
+                    }
+#endif // __RV_BIT_WIDTH__ == 64
                 default:
                     return sub_type()->illegal_instruction(inst);
             }
@@ -593,7 +607,7 @@ namespace riscv_isa {
 #endif
 #if __RV_BIT_WIDTH__ == 64
 
-        RetT visit_arith_imm_w_set(InstructionArithImmWSet *inst) {
+        RetT visit_arith_imm_w_set(const InstructionArithImmWSet *inst) {
             switch (inst->get_funct3()) {
                 case ADDIWInst::FUNCT3:
                     return sub_type()->visit_addiw_inst(reinterpret_cast<const ADDIWInst *>(inst));
@@ -618,7 +632,7 @@ namespace riscv_isa {
             }
         }
 
-        RetT visit_arith_reg_w_set(InstructionArithRegWSet *inst) {
+        RetT visit_arith_reg_w_set(const InstructionArithRegWSet *inst) {
             switch (inst->get_funct7()) {
                 case InstructionIntegerRegWSet::FUNCT7:
                     switch (inst->get_funct3()) {
@@ -0,0 +1,215 @@
+#ifndef RISCV_ISA_RV64A_HPP
+#define RISCV_ISA_RV64A_HPP
+
+
+#include "riscv_isa_utility.hpp"
+#include "instruction.hpp"
+
+
+#if defined(__RV_EXTENSION_A__) && __RV_BIT_WIDTH__ == 64
+namespace riscv_isa {
+    class InstructionAtomicDSet : public InstructionAtomicSet {
+    protected:
+        InstructionAtomicDSet(UInnerT rd, UInnerT rs1, UInnerT rs2, bool aq, bool rl, UInnerT funct_atomic) :
+                InstructionAtomicSet{rd, FUNCT3, rs1, rs2, aq, rl, funct_atomic} {}
+
+    public:
+        static constexpr UInnerT FUNCT3 = 0b011;
+    };
+
+    class LRDInst : public InstructionAtomicDSet {
+    public:
+        LRDInst(UInnerT rd, UInnerT rs1, bool aq, bool rl) :
+                InstructionAtomicDSet{rd, rs1, 0, aq, rl, FUNCT_ATOMIC} {}
+
+        static constexpr UInnerT FUNCT_ATOMIC = 0b00010;
+
+        friend std::ostream &operator<<(std::ostream &stream, const LRDInst &inst) {
+            stream << "lr.d";
+            if (inst.get_rl()) stream << ".rl";
+            if (inst.get_aq()) stream << ".aq";
+            stream << "\tx" << inst.get_rd() << ",(x" << inst.get_rs1() << ')';
+            return stream;
+        }
+    };
+
+    class SCDInst : public InstructionAtomicDSet {
+    public:
+        SCDInst(UInnerT rd, UInnerT rs1, UInnerT rs2, bool aq, bool rl) :
+                InstructionAtomicDSet{rd, rs1, rs2, aq, rl, FUNCT_ATOMIC} {}
+
+        static constexpr UInnerT FUNCT_ATOMIC = 0b00011;
+
+        friend std::ostream &operator<<(std::ostream &stream, const SCDInst &inst) {
+            stream << "sc.d";
+            if (inst.get_rl()) stream << ".rl";
+            if (inst.get_aq()) stream << ".aq";
+            stream << "\tx" << inst.get_rd() << ", x" << inst.get_rs2() << ", (x" << inst.get_rs1() << ')';
+            return stream;
+        }
+    };
+
+    class AMOSWAPDInst : public InstructionAtomicDSet {
+    public:
+        AMOSWAPDInst(UInnerT rd, UInnerT rs1, UInnerT rs2, bool aq, bool rl) :
+                InstructionAtomicDSet{rd, rs1, rs2, aq, rl, FUNCT_ATOMIC} {}
+
+        static constexpr UInnerT FUNCT_ATOMIC = 0b00001;
+
+        friend std::ostream &operator<<(std::ostream &stream, const AMOSWAPDInst &inst) {
+            stream << "amoswap.d";
+            if (inst.get_rl()) stream << ".rl";
+            if (inst.get_aq()) stream << ".aq";
+            stream << "\tx" << inst.get_rd() << ", x" << inst.get_rs2() << ", (x" << inst.get_rs1() << ')';
+            return stream;
+        }
+    };
+
+    class AMOADDDInst : public InstructionAtomicDSet {
+    public:
+        AMOADDDInst(UInnerT rd, UInnerT rs1, UInnerT rs2, bool aq, bool rl) :
+                InstructionAtomicDSet{rd, rs1, rs2, aq, rl, FUNCT_ATOMIC} {}
+
+        static constexpr UInnerT FUNCT_ATOMIC = 0b00000;
+
+        friend std::ostream &operator<<(std::ostream &stream, const AMOADDDInst &inst) {
+            stream << "amoadd.d";
+            if (inst.get_rl()) stream << ".rl";
+            if (inst.get_aq()) stream << ".aq";
+            stream << "\tx" << inst.get_rd() << ", x" << inst.get_rs2() << ", (x" << inst.get_rs1() << ')';
+            return stream;
+        }
+    };
+
+    class AMOXORDInst : public InstructionAtomicDSet {
+    public:
+        AMOXORDInst(UInnerT rd, UInnerT rs1, UInnerT rs2, bool aq, bool rl) :
+                InstructionAtomicDSet{rd, rs1, rs2, aq, rl, FUNCT_ATOMIC} {}
+
+        static constexpr UInnerT FUNCT_ATOMIC = 0b00100;
+
+        friend std::ostream &operator<<(std::ostream &stream, const AMOXORDInst &inst) {
+            stream << "amoxor.d";
+            if (inst.get_rl()) stream << ".rl";
+            if (inst.get_aq()) stream << ".aq";
+            stream << "\tx" << inst.get_rd() << ", x" << inst.get_rs2() << ", (x" << inst.get_rs1() << ')';
+            return stream;
+        }
+    };
+
+    class AMOANDDInst : public InstructionAtomicDSet {
+    public:
+        AMOANDDInst(UInnerT rd, UInnerT rs1, UInnerT rs2, bool aq, bool rl) :
+                InstructionAtomicDSet{rd, rs1, rs2, aq, rl, FUNCT_ATOMIC} {}
+
+        static constexpr UInnerT FUNCT_ATOMIC = 0b01100;
+
+        friend std::ostream &operator<<(std::ostream &stream, const AMOANDDInst &inst) {
+            stream << "amoand.d";
+            if (inst.get_rl()) stream << ".rl";
+            if (inst.get_aq()) stream << ".aq";
+            stream << "\tx" << inst.get_rd() << ", x" << inst.get_rs2() << ", (x" << inst.get_rs1() << ')';
+            return stream;
+        }
+    };
+
+    class AMOORDInst : public InstructionAtomicDSet {
+    public:
+        AMOORDInst(UInnerT rd, UInnerT rs1, UInnerT rs2, bool aq, bool rl) :
+                InstructionAtomicDSet{rd, rs1, rs2, aq, rl, FUNCT_ATOMIC} {}
+
+        static constexpr UInnerT FUNCT_ATOMIC = 0b01000;
+
+        friend std::ostream &operator<<(std::ostream &stream, const AMOORDInst &inst) {
+            stream << "amoor.d";
+            if (inst.get_rl()) stream << ".rl";
+            if (inst.get_aq()) stream << ".aq";
+            stream << "\tx" << inst.get_rd() << ", x" << inst.get_rs2() << ", (x" << inst.get_rs1() << ')';
+            return stream;
+        }
+    };
+
+    class AMOMINDInst : public InstructionAtomicDSet {
+    public:
+        AMOMINDInst(UInnerT rd, UInnerT rs1, UInnerT rs2, bool aq, bool rl) :
+                InstructionAtomicDSet{rd, rs1, rs2, aq, rl, FUNCT_ATOMIC} {}
+
+        static constexpr UInnerT FUNCT_ATOMIC = 0b10000;
+
+        friend std::ostream &operator<<(std::ostream &stream, const AMOMINDInst &inst) {
+            stream << "amomin.d";
+            if (inst.get_rl()) stream << ".rl";
+            if (inst.get_aq()) stream << ".aq";
+            stream << "\tx" << inst.get_rd() << ", x" << inst.get_rs2() << ", (x" << inst.get_rs1() << ')';
+            return stream;
+        }
+    };
+
+    class AMOMAXDInst : public InstructionAtomicDSet {
+    public:
+        AMOMAXDInst(UInnerT rd, UInnerT rs1, UInnerT rs2, bool aq, bool rl) :
+                InstructionAtomicDSet{rd, rs1, rs2, aq, rl, FUNCT_ATOMIC} {}
+
+        static constexpr UInnerT FUNCT_ATOMIC = 0b10100;
+
+        friend std::ostream &operator<<(std::ostream &stream, const AMOMAXDInst &inst) {
+            stream << "amomax.d";
+            if (inst.get_rl()) stream << ".rl";
+            if (inst.get_aq()) stream << ".aq";
+            stream << "\tx" << inst.get_rd() << ", x" << inst.get_rs2() << ", (x" << inst.get_rs1() << ')';
+            return stream;
+        }
+    };
+
+    class AMOMINUDInst : public InstructionAtomicDSet {
+    public:
+        AMOMINUDInst(UInnerT rd, UInnerT rs1, UInnerT rs2, bool aq, bool rl) :
+                InstructionAtomicDSet{rd, rs1, rs2, aq, rl, FUNCT_ATOMIC} {}
+
+        static constexpr UInnerT FUNCT_ATOMIC = 0b11000;
+
+        friend std::ostream &operator<<(std::ostream &stream, const AMOMINUDInst &inst) {
+            stream << "amominu.d";
+            if (inst.get_rl()) stream << ".rl";
+            if (inst.get_aq()) stream << ".aq";
+            stream << "\tx" << inst.get_rd() << ", x" << inst.get_rs2() << ", (x" << inst.get_rs1() << ')';
+            return stream;
+        }
+    };
+
+    class AMOMAXUDInst : public InstructionAtomicDSet {
+    public:
+        AMOMAXUDInst(UInnerT rd, UInnerT rs1, UInnerT rs2, bool aq, bool rl) :
+                InstructionAtomicDSet{rd, rs1, rs2, aq, rl, FUNCT_ATOMIC} {}
+
+        static constexpr UInnerT FUNCT_ATOMIC = 0b11100;
+
+        friend std::ostream &operator<<(std::ostream &stream, const AMOMAXUDInst &inst) {
+            stream << "amomaxu.d";
+            if (inst.get_rl()) stream << ".rl";
+            if (inst.get_aq()) stream << ".aq";
+            stream << "\tx" << inst.get_rd() << ", x" << inst.get_rs2() << ", (x" << inst.get_rs1() << ')';
+            return stream;
+        }
+    };
+}
+
+#define riscv_isa_instruction_64a_map(func) \
+    func(LRD, lrd) \
+    func(SCD, scd) \
+    func(AMOSWAPD, amoswapd) \
+    func(AMOADDD, amoaddd) \
+    func(AMOXORD, amoxord) \
+    func(AMOANDD, amoandd) \
+    func(AMOORD, amoord) \
+    func(AMOMIND, amomind) \
+    func(AMOMAXD, amomaxd) \
+    func(AMOMINUD, amominud) \
+    func(AMOMAXUD, amomaxud)
+
+#else
+#define riscv_isa_instruction_64a_map(func)
+#endif // defined(__RV_EXTENSION_A__) && __RV_BIT_WIDTH__ == 64
+
+
+#endif //RISCV_ISA_RV64A_HPP
@@ -5,6 +5,7 @@
 #include <atomic>
 
 #include "riscv_isa_utility.hpp"
+#include "guest_atomic.hpp"
 
 
 #define _riscv_isa_use_all_xlen(xlen) \
@@ -224,14 +225,50 @@ namespace riscv_isa {
 
 #endif // defined(__RV_EXTENSION_M__)
 #if defined(__RV_EXTENSION_A__)
-        // todo: memory order
+        /// weakest host order satisfying the aq and rl bits, both set means sequentially consistent.
+        riscv_isa_static_inline std::memory_order memory_order(bool aq, bool rl) {
+            return aq ? (rl ? std::memory_order_seq_cst : std::memory_order_acquire) :
+                   (rl ? std::memory_order_release : std::memory_order_relaxed);
+        }
+
+        /// exponential backoff after a failed compare exchange, delay starts from 1.
+        riscv_isa_static_inline void backoff(usize &delay) {
+            for (usize i = 0; i < delay; ++i) {
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#elif defined(__aarch64__)
+                asm volatile("yield");
+#endif
+            }
+
+            if (delay < 64) delay <<= 1u;
+        }
+
+        /// order of the load part of order, used as failure order of compare exchange.
+        riscv_isa_static_inline std::memory_order memory_order_load(std::memory_order order) {
+            return order == std::memory_order_release ? std::memory_order_relaxed :
+                   order == std::memory_order_acq_rel ? std::memory_order_acquire : order;
+        }
+
+        /// first load of a compare exchange loop, which ends without any store if the value needs no update. an amo
+        /// with rl still orders as a store then, so the release part of order is kept by a fence before the load.
+        template<typename ValT>
+        riscv_isa_static_inline ValT load_for_update(const ValT *a, std::memory_order order) {
+            if (order == std::memory_order_release || order == std::memory_order_acq_rel ||
+                order == std::memory_order_seq_cst)
+                std::atomic_thread_fence(std::memory_order_release);
+
+            return guest_atomic::load(a, memory_order_load(order));
+        }
 
         template<typename xlen>
         struct AMOSWAP {
         public:
             _riscv_isa_use_all_xlen(xlen);
 
-            static XLenT op(std::atomic<XLenT> *a, XLenT b) { return a->exchange(b); }
+            static XLenT op(XLenT *a, XLenT b, std::memory_order order) {
+                return guest_atomic::exchange(a, b, order);
+            }
         };
 
         template<typename xlen>
@@ -239,7 +276,9 @@ namespace riscv_isa {
         public:
             _riscv_isa_use_all_xlen(xlen);
 
-            static XLenT op(std::atomic<XLenT> *a, XLenT b) { return a->fetch_add(b); }
+            static XLenT op(XLenT *a, XLenT b, std::memory_order order) {
+                return guest_atomic::fetch_add(a, b, order);
+            }
         };
 
         template<typename xlen>
@@ -247,7 +286,9 @@ namespace riscv_isa {
         public:
             _riscv_isa_use_all_xlen(xlen);
 
-            static XLenT op(std::atomic<XLenT> *a, XLenT b) { return a->fetch_and(b); }
+            static XLenT op(XLenT *a, XLenT b, std::memory_order order) {
+                return guest_atomic::fetch_and(a, b, order);
+            }
         };
 
         template<typename xlen>
@@ -255,7 +296,9 @@ namespace riscv_isa {
         public:
             _riscv_isa_use_all_xlen(xlen);
 
-            static XLenT op(std::atomic<XLenT> *a, XLenT b) { return a->fetch_or(b); }
+            static XLenT op(XLenT *a, XLenT b, std::memory_order order) {
+                return guest_atomic::fetch_or(a, b, order);
+            }
         };
 
         template<typename xlen>
@@ -263,7 +306,9 @@ namespace riscv_isa {
         public:
             _riscv_isa_use_all_xlen(xlen);
 
-            static XLenT op(std::atomic<XLenT> *a, XLenT b) { return a->fetch_xor(b); }
+            static XLenT op(XLenT *a, XLenT b, std::memory_order order) {
+                return guest_atomic::fetch_xor(a, b, order);
+            }
         };
 
         template<typename xlen>
@@ -271,10 +316,12 @@ namespace riscv_isa {
         public:
             _riscv_isa_use_all_xlen(xlen);
 
-            static XLenT op(std::atomic<XLenT> *a, XLenT b) {
-                XLenT ret = a->load();
+            static XLenT op(XLenT *a, XLenT b, std::memory_order order) {
+                XLenT ret = load_for_update(a, order);
 
-                while(ret > b && !a->compare_exchange_weak(ret, b)) {}
+                for (usize delay = 1; ret > b && !guest_atomic::compare_exchange_weak(
+                        a, ret, b, order, memory_order_load(order));)
+                    backoff(delay);
 
                 return ret;
             }
@@ -285,10 +332,12 @@ namespace riscv_isa {
         public:
             _riscv_isa_use_all_xlen(xlen);
 
-            static XLenT op(std::atomic<XLenT> *a, XLenT b) {
-                XLenT ret = a->load();
+            static XLenT op(XLenT *a, XLenT b, std::memory_order order) {
+                XLenT ret = load_for_update(a, order);
 
-                while(ret < b && !a->compare_exchange_weak(ret, b)) {}
+                for (usize delay = 1; ret < b && !guest_atomic::compare_exchange_weak(
+                        a, ret, b, order, memory_order_load(order));)
+                    backoff(delay);
 
                 return ret;
             }
@@ -299,10 +348,12 @@ namespace riscv_isa {
         public:
             _riscv_isa_use_all_xlen(xlen);
 
-            static XLenT op(std::atomic<XLenT> *a, UXLenT b) {
-                XLenT ret = a->load();
+            static XLenT op(XLenT *a, UXLenT b, std::memory_order order) {
+                XLenT ret = load_for_update(a, order);
 
-                while(static_cast<UXLenT>(ret) > b && !a->compare_exchange_weak(ret, b)) {}
+                for (usize delay = 1; static_cast<UXLenT>(ret) > b && !guest_atomic::compare_exchange_weak(
+                        a, ret, static_cast<XLenT>(b), order, memory_order_load(order));)
+                    backoff(delay);
 
                 return ret;
             }
@@ -313,10 +364,12 @@ namespace riscv_isa {
         public:
             _riscv_isa_use_all_xlen(xlen);
 
-            static XLenT op(std::atomic<XLenT> *a, UXLenT b) {
-                XLenT ret = a->load();
+            static XLenT op(XLenT *a, UXLenT b, std::memory_order order) {
+                XLenT ret = load_for_update(a, order);
 
-                while(static_cast<UXLenT>(ret) < b && !a->compare_exchange_weak(ret, b)) {}
+                for (usize delay = 1; static_cast<UXLenT>(ret) < b && !guest_atomic::compare_exchange_weak(
+                        a, ret, static_cast<XLenT>(b), order, memory_order_load(order));)
+                    backoff(delay);
 
                 return ret;
             }
@@ -168,7 +168,7 @@ namespace riscv_isa {
             CSR_REGISTER_NUM,
         };
 
-    private:
+        /// misa at reset, every extension compiled in.
         static constexpr xlen_trait::UXLenT MISA_INIT =
                 get_bits<UXLenT, 2, 0, xlen::XLEN - 2>(xlen::XLEN_INDEX - 4)
 #ifdef __RV_EXTENSION_A__
@@ -230,17 +230,95 @@ namespace riscv_isa {
 #endif
         ;
 
+    private:
         xlen_trait::UXLenT inner[CSR_REGISTER_NUM];
 
     public:
         static constexpr usize READ_ONLY_BITS = 0b11;
 
+        /// number of csr addresses, csr number is 12 bits.
+        static constexpr usize CSR_ADDRESS_NUM = 0x1000;
+
+        /// decoded information of a csr number. index is CSR_REGISTER_NUM if the csr is not defined.
+        struct CSRInfo {
+        public:
+            u16 index;
+            PrivilegeLevel privilege;
+            bool read_only;
+        };
+
+    private:
+        /// following function transfer csr number to real index at compile time, only used to build the table.
+
+        static constexpr usize _get_index(usize csr) {
+            return
+#define _riscv_isa_csr_get_index(NAME, name, num) \
+                    csr == (num) ? NAME :
+                    riscv_isa_csr_reg_map(_riscv_isa_csr_get_index)
+#undef _riscv_isa_csr_get_index
+                    CSR_REGISTER_NUM;
+        }
+
+        /// csr requiring higher privilege than level is treated as not defined.
+        static constexpr CSRInfo _get_csr_info(usize csr, usize level) {
+            return CSRInfo{static_cast<u16>(get_bits<usize, 10, 8>(csr) <= level ? _get_index(csr) : CSR_REGISTER_NUM),
+                           static_cast<PrivilegeLevel>(get_bits<usize, 10, 8>(csr)),
+                           get_bits<usize, 12, 10>(csr) == READ_ONLY_BITS};
+        }
+
+    public:
+        /// csr number to csr info table as seen from one privilege level, constant initialized so no work is done
+        /// at runtime.
+
+        template<PrivilegeLevel level, typename T = typename make_index_sequence<CSR_ADDRESS_NUM>::type>
+        struct CSRTable;
+
+        template<PrivilegeLevel level, usize... I>
+        struct CSRTable<level, index_sequence<I...>> {
+        public:
+            static const CSRInfo inner[sizeof...(I)];
+        };
+
         static usize get_read_write_bits(usize num) { return get_bits<usize, 12, 10>(num); }
 
         static PrivilegeLevel get_privilege_bits(usize num) {
             return static_cast<PrivilegeLevel>(get_bits<usize, 10, 8>(num));
         }
 
+        /// cycle, time, instret and hpmcounter3 - hpmcounter31, including their machine mode and high half alias.
+        /// these are not stored but derived when read.
+
+        static bool is_counter(usize num) {
+            usize base = num & ~bits_mask<usize, 8, 0>::val;
+            return (base == 0xB00 || base == 0xC00) && get_bits<usize, 7, 5>(num) == 0;
+        }
+
+        static constexpr usize COUNTER_CYCLE = 0;
+        static constexpr usize COUNTER_TIME = 1;
+        static constexpr usize COUNTER_INSTRET = 2;
+        static constexpr usize COUNTER_HPM_BASE = 3;
+        static constexpr usize HPM_COUNTER_NUM = 29;
+
+        static usize get_counter_bits(usize num) { return get_bits<usize, 5, 0>(num); }
+
+        static bool is_counter_high_half(usize num) { return get_bit<usize, 7>(num) != 0; }
+
+        static bool is_user_counter(usize num) { return get_bits<usize, 12, 8>(num) == 0xC; }
+
+        /// mhpmevent3 - mhpmevent31.
+
+        static bool is_hpm_event(usize num) { return num >= 0x323 && num <= 0x33F; }
+
+        /// mstatus, mideleg, mie, sstatus and sie, writing them may unmask a pending interrupt.
+
+        static bool is_interrupt_enable(usize num) {
+            return num == 0x300 || num == 0x303 || num == 0x304 || num == 0x100 || num == 0x104;
+        }
+
+        /// mip and sip, pending bits are kept by the hart instead.
+
+        static bool is_interrupt_pending(usize num) { return num == 0x344 || num == 0x144; }
+
         CSRRegister(xlen_trait::UXLenT hart_id) { init_csr(hart_id); }
 
         void init_csr(xlen_trait::UXLenT hart_id) {
@@ -254,30 +332,33 @@ namespace riscv_isa {
         }
 
         /// following function transfer csr number to real index.
-        /// if csr not defined, csr_num will be returned.
+        /// if csr not defined, CSR_REGISTER_NUM will be returned.
 
-        static usize get_index(usize csr) {
-            switch (csr) {
-#define _riscv_isa_csr_get_index(NAME, name, num) \
-                case num: \
-                    return NAME;
-                riscv_isa_csr_reg_map(_riscv_isa_csr_get_index)
-#undef _riscv_isa_csr_get_index
-                default:
-                    return CSR_REGISTER_NUM;
-            }
+        static usize get_index(usize csr) { return get_csr_info(csr).index; }
+
+        static const CSRInfo &get_csr_info(usize csr) {
+            riscv_isa_assert(csr < CSR_ADDRESS_NUM);
+            return CSRTable<PrivilegeLevel::MACHINE_MODE>::inner[csr];
         }
 
+        /// index comes from the csr table, so it is only checked in debug build.
+
         const UXLenT &operator[](usize index) const {
-            if (index >= CSR_REGISTER_NUM) riscv_isa_abort("csr index out of boundary!");
+            riscv_isa_assert(index < CSR_REGISTER_NUM);
             return inner[index];
         }
 
         UXLenT &operator[](usize index) {
-            if (index >= CSR_REGISTER_NUM) riscv_isa_abort("csr index out of boundary!");
+            riscv_isa_assert(index < CSR_REGISTER_NUM);
             return inner[index];
         }
     };
+
+    template<typename xlen>
+    template<PrivilegeLevel level, usize... I>
+    const typename CSRRegister<xlen>::CSRInfo CSRRegister<xlen>::CSRTable<level, index_sequence<I...>>::inner[] = {
+            CSRRegister<xlen>::_get_csr_info(I, static_cast<usize>(level))...
+    };
 }
 
 
@@ -51,7 +51,7 @@
     func(MINSTRETH, minstreth, 0xB82) \
     _riscv_isa_csr_reg_pos_range(3, 32, func, MHPMCOUNTER, mhpmcounter, H, h, 0xB80)
 #else
-#define _riscv_isa_machine_mode_32_csr_map(func, func_range, func_pos_range)
+#define _riscv_isa_machine_mode_32_csr_map(func)
 #endif
 
 #if __RV_BIT_WIDTH__ == 32
@@ -61,7 +61,7 @@
     func(INSTRETH, instreth, 0xC82) \
     _riscv_isa_csr_reg_pos_range(3, 32, func, HPMCOUNTER, hpmcounter, H, h, 0xC80)
 #else
-#define _riscv_isa_user_mode_32_csr_map(func, func_range, func_pos_range)
+#define _riscv_isa_user_mode_32_csr_map(func)
 #endif
 
 #if defined(__RV_EXTENSION_N__)
@@ -40,6 +40,11 @@
 #define RISCV_IMP_ID 0
 #endif
 
+/// frequency of the time csr in hz, the host monotonic clock is scaled to it.
+#ifndef RISCV_TIME_FREQUENCY
+#define RISCV_TIME_FREQUENCY 10000000u
+#endif
+
 namespace riscv_isa {
 #define riscv_isa_static_inline static inline __attribute__((always_inline))
 #define riscv_isa_unused __attribute__((unused))
@@ -251,6 +256,33 @@ namespace riscv_isa {
     template<typename T, typename U>
     T *dyn_cast(U *self) { return is_type<T>(self) ? reinterpret_cast<T *>(self) : nullptr; }
 
+    /// compile time integer sequence, generated in logarithm depth so that large tables can be built from it.
+
+    template<usize... I>
+    struct index_sequence {
+    public:
+        using type = index_sequence;
+    };
+
+    template<typename T, typename U>
+    struct _concat_index_sequence;
+
+    template<usize... I, usize... J>
+    struct _concat_index_sequence<index_sequence<I...>, index_sequence<J...>>
+            : public index_sequence<I..., (sizeof...(I) + J)...> {
+    };
+
+    template<usize N>
+    struct make_index_sequence : public _concat_index_sequence<
+            typename make_index_sequence<N / 2>::type, typename make_index_sequence<N - N / 2>::type> {
+    };
+
+    template<>
+    struct make_index_sequence<0> : public index_sequence<> {};
+
+    template<>
+    struct make_index_sequence<1> : public index_sequence<0> {};
+
     enum class PrivilegeLevel : u8 {
 #if defined(__RV_USER_MODE__)
         USER_MODE = 0b00,
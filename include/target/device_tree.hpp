@@ -0,0 +1,353 @@
+#ifndef RISCV_ISA_DEVICE_TREE_HPP
+#define RISCV_ISA_DEVICE_TREE_HPP
+
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "riscv_isa_utility.hpp"
+#include "trap/trap.hpp"
+
+
+namespace riscv_isa {
+    /// writes a flattened device tree blob, version 17, in one pass. nodes are opened and closed in order and
+    /// properties belong to the node opened last, so no tree is built in memory. property names are kept once in
+    /// the strings block.
+    class FDTWriter {
+    public:
+        static constexpr u32 MAGIC = 0xd00dfeed;
+        static constexpr u32 VERSION = 17;
+        static constexpr u32 LAST_COMPATIBLE_VERSION = 16;
+
+        static constexpr u32 BEGIN_NODE = 1;
+        static constexpr u32 END_NODE = 2;
+        static constexpr u32 PROP = 3;
+        static constexpr u32 END = 9;
+
+        static constexpr usize HEADER_SIZE = 40;
+        static constexpr usize RESERVE_MAP_SIZE = 16; // terminating entry only.
+
+    private:
+        std::vector<u8> structure;
+        std::string strings;
+        usize depth;
+
+        void push_u32(u32 val) {
+            u8 bytes[] = {static_cast<u8>(val >> 24u), static_cast<u8>(val >> 16u),
+                          static_cast<u8>(val >> 8u), static_cast<u8>(val)};
+            structure.insert(structure.end(), bytes, bytes + sizeof(bytes));
+        }
+
+        void push_bytes(const void *data, usize length) {
+            const u8 *bytes = static_cast<const u8 *>(data);
+            structure.insert(structure.end(), bytes, bytes + length);
+            structure.resize((structure.size() + 3) / 4 * 4, 0);
+        }
+
+        /// offset of name in strings block, appended if it is not there yet.
+        u32 get_name_offset(const char *name) {
+            usize length = strlen(name) + 1;
+
+            for (usize offset = 0; offset < strings.size(); offset += strlen(strings.c_str() + offset) + 1)
+                if (strings.compare(offset, length, name, length) == 0) return static_cast<u32>(offset);
+
+            usize offset = strings.size();
+            strings.append(name, length);
+            return static_cast<u32>(offset);
+        }
+
+        static void put_u32(std::vector<u8> &blob, usize offset, u32 val) {
+            blob[offset] = static_cast<u8>(val >> 24u);
+            blob[offset + 1] = static_cast<u8>(val >> 16u);
+            blob[offset + 2] = static_cast<u8>(val >> 8u);
+            blob[offset + 3] = static_cast<u8>(val);
+        }
+
+    public:
+        FDTWriter() : structure{}, strings{}, depth{0} {}
+
+        /// the root node has an empty name.
+        void begin_node(const char *name) {
+            push_u32(BEGIN_NODE);
+            push_bytes(name, strlen(name) + 1);
+            ++depth;
+        }
+
+        void end_node() {
+            riscv_isa_assert(depth > 0);
+
+            push_u32(END_NODE);
+            --depth;
+        }
+
+        void property(const char *name, const void *data, usize length) {
+            push_u32(PROP);
+            push_u32(static_cast<u32>(length));
+            push_u32(get_name_offset(name));
+            push_bytes(data, length);
+        }
+
+        /// property of no value, which is true by being present.
+        void property(const char *name) { property(name, nullptr, 0); }
+
+        void property_string(const char *name, const char *val) { property(name, val, strlen(val) + 1); }
+
+        /// cells are converted to big endian.
+        void property_cells(const char *name, const std::vector<u32> &cells) {
+            push_u32(PROP);
+            push_u32(static_cast<u32>(cells.size() * sizeof(u32)));
+            push_u32(get_name_offset(name));
+            for (u32 cell: cells) push_u32(cell);
+        }
+
+        void property_u32(const char *name, u32 val) { property_cells(name, std::vector<u32>{val}); }
+
+        /// the blob, every node has to be closed.
+        std::vector<u8> finish(u32 boot_cpuid = 0) const {
+            riscv_isa_assert(depth == 0);
+
+            usize structure_offset = HEADER_SIZE + RESERVE_MAP_SIZE;
+            usize structure_size = structure.size() + sizeof(u32);
+            usize strings_offset = structure_offset + structure_size;
+
+            std::vector<u8> blob(strings_offset + strings.size(), 0);
+            put_u32(blob, 0x00, MAGIC);
+            put_u32(blob, 0x04, static_cast<u32>(blob.size()));
+            put_u32(blob, 0x08, static_cast<u32>(structure_offset));
+            put_u32(blob, 0x0c, static_cast<u32>(strings_offset));
+            put_u32(blob, 0x10, static_cast<u32>(HEADER_SIZE));
+            put_u32(blob, 0x14, VERSION);
+            put_u32(blob, 0x18, LAST_COMPATIBLE_VERSION);
+            put_u32(blob, 0x1c, boot_cpuid);
+            put_u32(blob, 0x20, static_cast<u32>(strings.size()));
+            put_u32(blob, 0x24, static_cast<u32>(structure_size));
+
+            if (!structure.empty()) memcpy(blob.data() + structure_offset, structure.data(), structure.size());
+            put_u32(blob, strings_offset - sizeof(u32), END);
+            if (!strings.empty()) memcpy(blob.data() + strings_offset, strings.data(), strings.size());
+
+            return blob;
+        }
+    };
+
+    /// description of a machine as a kernel sees it, turned into a device tree blob by build, so no device tree
+    /// source has to be maintained next to the code building the machine.
+    ///
+    /// harts get a riscv,cpu-intc interrupt controller each, the clint and the plic are wired to their machine and
+    /// supervisor interrupts in the context order of PLIC, and every other device is a source of the plic. addresses
+    /// and sizes are two cells.
+    class DeviceTree {
+    public:
+        /// riscv,isa string of misa, e.g. "rv64imac", with the z extensions compiled in appended.
+        template<typename UXLenT>
+        static std::string get_isa_string(UXLenT misa) {
+            static const char ORDER[] = "iemafdqlcbjtpvnh";
+
+            usize xlen = 16u << (misa >> (sizeof(UXLenT) * 8 - 2));
+            std::string isa = "rv" + std::to_string(xlen);
+
+            for (const char *letter = ORDER; *letter != '\0'; ++letter)
+                if ((misa & static_cast<UXLenT>(1) << (*letter - 'a')) != 0) isa += *letter;
+
+#if defined(__RV_EXTENSION_ZICSR__)
+            isa += "_zicsr";
+#endif
+#if defined(__RV_EXTENSION_ZIFENCEI__)
+            isa += "_zifencei";
+#endif
+
+            return isa;
+        }
+
+    private:
+        enum class Kind {
+            CLINT, PLIC, UART, VIRTIO,
+        };
+
+        struct Region {
+        public:
+            u64 base, size;
+        };
+
+        struct Device {
+        public:
+            Kind kind;
+            u64 base, size;
+            u32 irq;
+        };
+
+        usize hart_num;
+        std::string isa;
+        std::vector<Region> memory;
+        std::vector<Device> devices;
+        std::string bootargs;
+
+        static std::string get_node_name(const char *name, u64 base) {
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "@%llx", static_cast<unsigned long long>(base));
+            return name + std::string{buffer};
+        }
+
+        static std::vector<u32> get_reg(u64 base, u64 size) {
+            return std::vector<u32>{static_cast<u32>(base >> 32u), static_cast<u32>(base),
+                                    static_cast<u32>(size >> 32u), static_cast<u32>(size)};
+        }
+
+        u32 get_intc_phandle(usize hart_id) const { return static_cast<u32>(hart_id + 1); }
+
+        u32 get_plic_phandle() const { return static_cast<u32>(hart_num + 1); }
+
+        const Device *find(Kind kind) const {
+            for (auto &device: devices)
+                if (device.kind == kind) return &device;
+
+            return nullptr;
+        }
+
+        /// interrupts-extended with a pair of interrupts per hart.
+        std::vector<u32> get_hart_interrupts(u32 machine, u32 supervisor) const {
+            std::vector<u32> cells;
+            for (usize i = 0; i < hart_num; ++i) {
+                cells.push_back(get_intc_phandle(i));
+                cells.push_back(machine);
+                cells.push_back(get_intc_phandle(i));
+                cells.push_back(supervisor);
+            }
+
+            return cells;
+        }
+
+        void write_cpus(FDTWriter &writer) const {
+            writer.begin_node("cpus");
+            writer.property_u32("#address-cells", 1);
+            writer.property_u32("#size-cells", 0);
+            writer.property_u32("timebase-frequency", RISCV_TIME_FREQUENCY);
+
+            for (usize i = 0; i < hart_num; ++i) {
+                writer.begin_node(get_node_name("cpu", i).c_str());
+                writer.property_string("device_type", "cpu");
+                writer.property_u32("reg", static_cast<u32>(i));
+                writer.property_string("status", "okay");
+                writer.property_string("compatible", "riscv");
+                writer.property_string("riscv,isa", isa.c_str());
+
+                writer.begin_node("interrupt-controller");
+                writer.property_u32("#interrupt-cells", 1);
+                writer.property("interrupt-controller");
+                writer.property_string("compatible", "riscv,cpu-intc");
+                writer.property_u32("phandle", get_intc_phandle(i));
+                writer.end_node();
+
+                writer.end_node();
+            }
+
+            writer.end_node();
+        }
+
+        void write_device(FDTWriter &writer, const Device &device, bool has_plic) const {
+            static const char *const NAMES[] = {"clint", "plic", "serial", "virtio_mmio"};
+
+            writer.begin_node(get_node_name(NAMES[static_cast<usize>(device.kind)], device.base).c_str());
+            writer.property_cells("reg", get_reg(device.base, device.size));
+
+            switch (device.kind) {
+                case Kind::CLINT:
+                    writer.property_string("compatible", "riscv,clint0");
+                    writer.property_cells("interrupts-extended", get_hart_interrupts(
+                            trap::MACHINE_SOFTWARE_INTERRUPT, trap::MACHINE_TIMER_INTERRUPT));
+                    break;
+                case Kind::PLIC:
+                    writer.property_string("compatible", "riscv,plic0");
+                    writer.property_u32("#address-cells", 0);
+                    writer.property_u32("#interrupt-cells", 1);
+                    writer.property("interrupt-controller");
+                    writer.property_u32("riscv,ndev", device.irq);
+                    writer.property_cells("interrupts-extended", get_hart_interrupts(
+                            trap::MACHINE_EXTERNAL_INTERRUPT, trap::SUPERVISOR_EXTERNAL_INTERRUPT));
+                    writer.property_u32("phandle", get_plic_phandle());
+                    break;
+                case Kind::UART:
+                    writer.property_string("compatible", "ns16550a");
+                    writer.property_u32("clock-frequency", RISCV_TIME_FREQUENCY);
+                    break;
+                case Kind::VIRTIO:
+                    writer.property_string("compatible", "virtio,mmio");
+                    break;
+            }
+
+            if (has_plic && (device.kind == Kind::UART || device.kind == Kind::VIRTIO)) {
+                writer.property_u32("interrupt-parent", get_plic_phandle());
+                writer.property_u32("interrupts", device.irq);
+            }
+
+            writer.end_node();
+        }
+
+    public:
+        DeviceTree(usize hart_num, const std::string &isa) : hart_num{hart_num}, isa{isa} {}
+
+        usize get_hart_num() const { return hart_num; }
+
+        const std::string &get_isa() const { return isa; }
+
+        void add_memory(u64 base, u64 size) { memory.push_back(Region{base, size}); }
+
+        void add_clint(u64 base, u64 size) { devices.push_back(Device{Kind::CLINT, base, size, 0}); }
+
+        /// source_num counts sources from 1, source 0 does not exist.
+        void add_plic(u64 base, u64 size, u32 source_num) {
+            devices.push_back(Device{Kind::PLIC, base, size, source_num});
+        }
+
+        /// the first uart is the console of the kernel.
+        void add_uart(u64 base, u64 size, u32 irq) { devices.push_back(Device{Kind::UART, base, size, irq}); }
+
+        void add_virtio(u64 base, u64 size, u32 irq) { devices.push_back(Device{Kind::VIRTIO, base, size, irq}); }
+
+        void set_bootargs(const std::string &args) { bootargs = args; }
+
+        std::vector<u8> build() const {
+            FDTWriter writer{};
+            const Device *uart = find(Kind::UART);
+            bool has_plic = find(Kind::PLIC) != nullptr;
+
+            writer.begin_node("");
+            writer.property_u32("#address-cells", 2);
+            writer.property_u32("#size-cells", 2);
+            writer.property_string("compatible", "riscv-isa");
+            writer.property_string("model", "riscv-isa");
+
+            writer.begin_node("chosen");
+            if (!bootargs.empty()) writer.property_string("bootargs", bootargs.c_str());
+            if (uart != nullptr) {
+                writer.property_string("stdout-path", get_node_name("/soc/serial", uart->base).c_str());
+            }
+            writer.end_node();
+
+            write_cpus(writer);
+
+            for (auto &region: memory) {
+                writer.begin_node(get_node_name("memory", region.base).c_str());
+                writer.property_string("device_type", "memory");
+                writer.property_cells("reg", get_reg(region.base, region.size));
+                writer.end_node();
+            }
+
+            writer.begin_node("soc");
+            writer.property_u32("#address-cells", 2);
+            writer.property_u32("#size-cells", 2);
+            writer.property_string("compatible", "simple-bus");
+            writer.property("ranges");
+            for (auto &device: devices) write_device(writer, device, has_plic);
+            writer.end_node();
+
+            writer.end_node();
+            return writer.finish();
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_DEVICE_TREE_HPP
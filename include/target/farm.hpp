@@ -0,0 +1,201 @@
+#ifndef RISCV_ISA_FARM_HPP
+#define RISCV_ISA_FARM_HPP
+
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "riscv_isa_utility.hpp"
+
+
+namespace riscv_isa {
+    /// fifo queue of fixed capacity with one producer and any number of consumers, the steal end of a chase-lev
+    /// deque without the owner end. push is only called by owner, steal may be called by any thread including owner,
+    /// so owner and thieves alike take the oldest element. capacity must be no less than the number of elements which
+    /// can be in the queue at the same time.
+    template<typename T>
+    class StealQueue {
+    private:
+        std::unique_ptr<std::atomic<T *>[]> buffer;
+        usize mask;
+        std::atomic<usize> top, bottom;
+
+    public:
+        /// capacity is rounded up to power of two.
+        explicit StealQueue(usize capacity) : mask{1}, top{0}, bottom{0} {
+            while (mask < capacity) mask <<= 1u;
+            buffer.reset(new std::atomic<T *>[mask]);
+            mask -= 1;
+        }
+
+        StealQueue(const StealQueue &other) = delete;
+
+        StealQueue &operator=(const StealQueue &other) = delete;
+
+        void push(T *val) {
+            usize b = bottom.load(std::memory_order_relaxed);
+            riscv_isa_assert(b - top.load(std::memory_order_acquire) <= mask);
+
+            buffer[b & mask].store(val, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_release);
+        }
+
+        /// take the oldest element, nullptr if empty or lost the race to another thread.
+        T *steal() {
+            usize t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            usize b = bottom.load(std::memory_order_acquire);
+
+            if (t >= b) return nullptr;
+
+            T *val = buffer[t & mask].load(std::memory_order_relaxed);
+            return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed) ?
+                   val : nullptr;
+        }
+    };
+
+    /// runs many independent jobs on a fixed pool of host threads. every job is run for at most quantum instructions
+    /// at a time, then it is queued again, so a long job cannot starve short ones.
+    ///
+    /// JobT is required to implement:
+    ///
+    ///     /// run at most budget instructions, false if the job ends.
+    ///     bool run(usize budget);
+    ///
+    ///     u64 get_instret();
+    ///
+    /// which every Hart does. jobs are owned by caller and must outlive run.
+    ///
+    /// every worker owns a queue, and takes the oldest job of its own queue before stealing from others, so jobs of one
+    /// worker are sliced round-robin. a lifo owner end would keep running the job just sliced, which is the
+    /// starvation slicing is there to prevent. a worker finding no job sleeps until a job is queued again or every
+    /// job ended.
+    template<typename JobT>
+    class Farm {
+    public:
+        static constexpr usize DEFAULT_QUANTUM = 0x10000;
+
+    private:
+        struct Worker {
+        public:
+            StealQueue<JobT> queue;
+            u64 instret;
+
+            explicit Worker(usize capacity) : queue{capacity}, instret{0} {}
+        };
+
+        usize thread_num, quantum;
+        std::vector<JobT *> jobs;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<usize> remain;
+        u64 instret, elapsed_ns;
+        /// bumped on every queued job, a worker sleeps until it changes from the value seen before it looked for one.
+        std::atomic<u64> generation;
+        std::atomic<usize> parked;
+        std::mutex idle_lock;
+        std::condition_variable idle;
+
+        JobT *take(usize id) {
+            JobT *job = workers[id]->queue.steal();
+
+            for (usize i = 1; job == nullptr && i < thread_num; ++i)
+                job = workers[(id + i) % thread_num]->queue.steal();
+
+            return job;
+        }
+
+        /// sleep until generation moves from seen or every job ended.
+        void park(u64 seen) {
+            std::unique_lock<std::mutex> guard{idle_lock};
+
+            parked.fetch_add(1, std::memory_order_seq_cst);
+            idle.wait(guard, [this, seen]() {
+                return generation.load(std::memory_order_seq_cst) != seen ||
+                       remain.load(std::memory_order_acquire) == 0;
+            });
+            parked.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        /// either a parking worker sees the new generation, or it is counted in parked before it is read here. the
+        /// lock is only taken while a worker sleeps.
+        void wake(bool all) {
+            generation.fetch_add(1, std::memory_order_seq_cst);
+            if (parked.load(std::memory_order_seq_cst) == 0) return;
+
+            std::lock_guard<std::mutex> guard{idle_lock};
+            if (all) idle.notify_all();
+            else idle.notify_one();
+        }
+
+        void work(usize id) {
+            Worker &worker = *workers[id];
+
+            while (remain.load(std::memory_order_acquire) != 0) {
+                u64 seen = generation.load(std::memory_order_seq_cst);
+                JobT *job = take(id);
+                if (job == nullptr) {
+                    park(seen);
+                    continue;
+                }
+
+                u64 before = job->get_instret();
+                bool alive = job->run(quantum);
+                worker.instret += job->get_instret() - before;
+
+                if (alive) {
+                    worker.queue.push(job);
+                    wake(false);
+                } else if (remain.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    wake(true);
+                }
+            }
+        }
+
+    public:
+        explicit Farm(usize thread_num, usize quantum = DEFAULT_QUANTUM) :
+                thread_num{thread_num == 0 ? 1 : thread_num}, quantum{quantum}, remain{0}, instret{0},
+                elapsed_ns{0}, generation{0}, parked{0} {}
+
+        Farm(const Farm &other) = delete;
+
+        Farm &operator=(const Farm &other) = delete;
+
+        void submit(JobT &job) { jobs.push_back(&job); }
+
+        /// run every submitted job to its end, then clear submitted jobs.
+        void run() {
+            workers.clear();
+            for (usize i = 0; i < thread_num; ++i) workers.emplace_back(new Worker{jobs.size()});
+            for (usize i = 0; i < jobs.size(); ++i) workers[i % thread_num]->queue.push(jobs[i]);
+            remain.store(jobs.size(), std::memory_order_release);
+
+            auto begin = std::chrono::steady_clock::now();
+
+            std::vector<std::thread> threads;
+            for (usize i = 1; i < thread_num; ++i) threads.emplace_back([this, i]() { work(i); });
+            work(0);
+            for (auto &thread: threads) thread.join();
+
+            elapsed_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - begin).count();
+            for (auto &worker: workers) instret += worker->instret;
+            jobs.clear();
+        }
+
+        /// instructions retired by all jobs in all runs.
+        u64 get_instret() const { return instret; }
+
+        u64 get_elapsed_ns() const { return elapsed_ns; }
+
+        /// aggregate throughput in million instructions per second.
+        double get_mips() const { return elapsed_ns == 0 ? 0 : static_cast<double>(instret) * 1000 / elapsed_ns; }
+    };
+}
+
+
+#endif //RISCV_ISA_FARM_HPP
@@ -0,0 +1,40 @@
+#ifndef RISCV_ISA_FLUSH_EPOCH_HPP
+#define RISCV_ISA_FLUSH_EPOCH_HPP
+
+
+#include <atomic>
+
+#include "riscv_isa_utility.hpp"
+
+
+namespace riscv_isa {
+    /// generation counters of address translation and instruction memory, shared by all harts of a machine.
+    ///
+    /// a hart executing sfence.vma or fence.i flushes its own caches at once and bumps the generation. every other
+    /// hart compares the generation with the last one it has seen at block boundaries, and flushes lazily if it
+    /// changed. there is no pause of other harts and nothing is done on memory accesses.
+    class FlushEpoch {
+    public:
+        std::atomic<u32> tlb, code;
+
+        FlushEpoch() : tlb{0}, code{0} {}
+
+        FlushEpoch(const FlushEpoch &other) = delete;
+
+        FlushEpoch &operator=(const FlushEpoch &other) = delete;
+
+        /// epoch shared by harts not belonging to any machine.
+        static FlushEpoch &get_default() {
+            static FlushEpoch epoch{};
+            return epoch;
+        }
+
+        /// returns the new generation.
+        static u32 bump(std::atomic<u32> &generation) {
+            return generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_FLUSH_EPOCH_HPP
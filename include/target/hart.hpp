@@ -3,12 +3,23 @@
 
 
 #include <atomic>
+#include <chrono>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include "riscv_isa_utility.hpp"
 #include "operators.hpp"
+#include "guest_atomic.hpp"
 #include "instruction/instruction_visitor.hpp"
 #include "register/register.hpp"
 #include "trap/trap.hpp"
+#include "hpm_event.hpp"
+#include "reservation_set.hpp"
+#include "flush_epoch.hpp"
+#include "timer_wheel.hpp"
+#include "semihosting.hpp"
 
 
 namespace riscv_isa {
@@ -22,6 +33,19 @@ public:
     using UXLenT = typename xlen::UXLenT;
     static constexpr usize XLEN = xlen::XLEN;
 
+    /// default number of instructions executed by one block in start().
+    static constexpr usize BLOCK_BUDGET = 4096;
+
+    static constexpr UXLenT MSTATUS_SIE = bit_mask<UXLenT, 1>::val;
+    static constexpr UXLenT MSTATUS_MIE = bit_mask<UXLenT, 3>::val;
+    /// attention bit outside the interrupt layout, the hart stops at next block exit while it is set.
+    static constexpr u32 ATTENTION_STOP = 1u << 31u;
+    /// set while the hart sleeps in wfi, tells the writer of attention to wake it.
+    static constexpr u32 ATTENTION_PARKED = 1u << 30u;
+    /// set when the timer deadline became earlier, so a hart parked in wfi sleeps again until the new one.
+    static constexpr u32 ATTENTION_TIMER = 1u << 29u;
+    static constexpr usize FENCE_TSO = 0b1000;
+
 private:
     IntRegT int_reg;
     XLenT pc;
@@ -29,9 +53,65 @@ private:
 protected:
     CSRRegT csr_reg;
 #if defined(__RV_EXTENSION_A__)
-    UXLenT reserve_address, reserve_value;
+    /// reserve_ptr is the host address of the reservation, nullptr if there is none.
+    ReservationSet *reservation_set;
+    const void *reserve_ptr;
+    u32 reserve_tag;
+    UXLenT reserve_value;
 #endif
-    PrivilegeLevel cur_level;
+
+    /// everything on the execution path which depends on the privilege level. there is one constant context for
+    /// each level, so instructions never check the level themselves and switching mode swaps the pointer.
+    struct PrivilegeContext {
+    public:
+        PrivilegeLevel level;
+        trap::ExceptionCode ecall_cause;
+        /// csr info table with csr of higher privilege marked as not defined.
+        const typename CSRRegT::CSRInfo *csr_table;
+    };
+
+    /// indexed by privilege level, level 0b10 is reserved and shares the supervisor context.
+    static const PrivilegeContext PRIVILEGE_CONTEXT[4];
+
+private:
+    /// context of the current privilege level, only switched by set_privilege_level, so the level, csr table and
+    /// ecall cause never disagree.
+    const PrivilegeContext *context;
+
+protected:
+    /// instructions are executed in blocks. the block length and the remaining budget are kept, so the number of
+    /// retired instructions is derived from them instead of counting each instruction.
+    usize block_length, block_remain;
+    u64 instret_offset, cycle_offset;
+
+    /// generations of flush epoch already applied to caches of this hart.
+    FlushEpoch *flush_epoch;
+    u32 tlb_epoch, code_epoch;
+
+    /// time follows retired instructions instead of host clock, so guest behavior does not depend on host speed.
+    bool deterministic;
+
+    /// future events of devices and timers in the time of this hart, expired at block boundaries.
+    TimerWheel timer_wheel;
+
+    /// executes semihosting calls, nullptr if ebreak is always a breakpoint.
+    Semihosting *semihosting;
+
+    /// hpm_event_mask has a bit set for every event selected by at least one mhpmevent, so an event nobody
+    /// listens to costs a single test. hpm_event_counter holds the counters selected by each event.
+    u32 hpm_event_mask;
+    u32 hpm_event_counter[HPM_EVENT_NUM];
+    u64 hpm_counter[CSRRegT::HPM_COUNTER_NUM];
+
+    /// attention word. interrupt pending bits use the layout of mip. it may be written by any thread, and is only
+    /// checked at block exit, on backward branches and jumps, and after writing a csr which may unmask an
+    /// interrupt. so a pending and enabled interrupt is taken within the block budget passed to run (BLOCK_BUDGET
+    /// in start) counted in retired instructions, and within one iteration of any loop.
+    std::atomic<u32> attention;
+
+    /// bits of attention which end the block early, stop, timer and interrupts which may be taken now. only the
+    /// thread of this hart uses it, so a pending but masked interrupt costs one and per check.
+    u32 attention_mask;
 
 private:
     SubT *sub_type() {
@@ -48,6 +128,8 @@ private:
         if (OP::op(sub_type()->get_x(rs1), sub_type()->get_x(rs2))) {
             XLenT imm = inst->get_imm();
             UXLenT target = imm + sub_type()->get_pc();
+            hpm_event(HPM_EVENT_BRANCH_TAKEN);
+            if (imm <= 0) check_attention();
             return sub_type()->jump_to_addr(target);
         } else {
             sub_type()->inc_pc(InstT::INST_WIDTH);
@@ -68,13 +150,18 @@ private:
             return sub_type()->internal_interrupt(trap::LOAD_ACCESS_FAULT, addr);
         }
 
+        ValT val;
         auto *ptr = sub_type()->template address_load<ValT>(addr);
-        if (ptr == nullptr) {
+        if (ptr != nullptr) {
+            val = guest_atomic::load(ptr);
+        } else if (!sub_type()->template mmio_load<ValT>(addr, val)) {
             return sub_type()->internal_interrupt(trap::LOAD_PAGE_FAULT, addr);
-        } else {
-            if (rd != 0) { sub_type()->set_x(rd, *ptr); }
         }
 
+        if (rd != 0) { sub_type()->set_x(rd, val); }
+
+        hpm_event(HPM_EVENT_LOAD);
+
         sub_type()->inc_pc(InstT::INST_WIDTH);
         return true;
     }
@@ -92,13 +179,19 @@ private:
             return sub_type()->internal_interrupt(trap::STORE_AMO_ACCESS_FAULT, addr);
         }
 
+        ValT val = static_cast<ValT>(sub_type()->get_x(rs2));
         auto *ptr = sub_type()->template address_store<ValT>(addr);
-        if (ptr == nullptr) {
+        if (ptr != nullptr) {
+#if defined(__RV_EXTENSION_A__)
+            reservation_set->invalidate(ptr);
+#endif
+            guest_atomic::store(ptr, val);
+        } else if (!sub_type()->template mmio_store<ValT>(addr, val)) {
             return sub_type()->internal_interrupt(trap::STORE_AMO_PAGE_FAULT, addr);
-        } else {
-            *ptr = static_cast<ValT>(sub_type()->get_x(rs2));
         }
 
+        hpm_event(HPM_EVENT_STORE);
+
         sub_type()->inc_pc(InstT::INST_WIDTH);
         return true;
     }
@@ -146,9 +239,13 @@ public:
     Hart(UXLenT hart_id, XLenT pc, IntRegT &reg) :
             int_reg{reg}, pc{pc}, csr_reg{hart_id},
 #if defined(__RV_EXTENSION_A__)
-            reserve_address{0}, reserve_value{0},
+            reservation_set{&ReservationSet::get_default()}, reserve_ptr{nullptr}, reserve_tag{0}, reserve_value{0},
 #endif
-            cur_level{PrivilegeLevel::MACHINE_MODE} {}
+            context{&PRIVILEGE_CONTEXT[static_cast<usize>(PrivilegeLevel::MACHINE_MODE)]},
+            block_length{0}, block_remain{0}, instret_offset{0}, cycle_offset{0},
+            flush_epoch{&FlushEpoch::get_default()}, tlb_epoch{0}, code_epoch{0}, deterministic{false},
+            semihosting{nullptr}, hpm_event_mask{0}, hpm_event_counter{}, hpm_counter{}, attention{0},
+            attention_mask{ATTENTION_STOP | ATTENTION_TIMER} {}
 
 ///     these functions are required to be implemented.
 ///
@@ -221,6 +318,240 @@ public:
 
     void set_x(usize index, XLenT val) { int_reg.set_x(index, val); }
 
+    /// retired instructions, only the instructions finished in current block are added when read.
+    u64 get_instret() const { return instret_offset + (block_length - block_remain); }
+
+    void set_instret(u64 val) { instret_offset = val - (block_length - block_remain); }
+
+    /// one instruction per cycle is assumed, the cycle counter only keeps its own offset to instret.
+    u64 get_cycle() const { return get_instret() + cycle_offset; }
+
+    void set_cycle(u64 val) { cycle_offset = val - get_instret(); }
+
+    /// level of the current context, which set_privilege_level is the only way to switch.
+    PrivilegeLevel get_privilege_level() const { return context->level; }
+
+    void set_privilege_level(PrivilegeLevel level) {
+        context = &PRIVILEGE_CONTEXT[static_cast<usize>(level)];
+        update_attention_mask();
+    }
+
+    /// following functions are thread safe, they can be called by devices or other harts. setting a bit takes no
+    /// lock, the futex is only woken if the hart is parked in wfi.
+
+    void raise_interrupt(UXLenT code) { set_attention(1u << code); }
+
+    void clear_interrupt(UXLenT code) { attention.fetch_and(~(1u << code), std::memory_order_release); }
+
+    u32 get_interrupt_pending() const { return attention.load(std::memory_order_acquire) & trap::INTERRUPT_MASK; }
+
+    /// start returns at next block exit.
+    void request_stop() { set_attention(ATTENTION_STOP); }
+
+    void clear_stop() { attention.fetch_and(~ATTENTION_STOP, std::memory_order_release); }
+
+    /// event expires on the thread of this hart once get_time reaches tick. a hart parked in wfi is woken to sleep
+    /// until the new deadline if it became earlier.
+    void schedule_timer(TimerEvent &event, u64 tick) {
+        if (timer_wheel.schedule(event, tick)) set_attention(ATTENTION_TIMER);
+    }
+
+    void cancel_timer(TimerEvent &event) { timer_wheel.cancel(event); }
+
+    /// harts sharing memory must share the flush epoch, set before the hart starts.
+    void set_flush_epoch(FlushEpoch *epoch) {
+        flush_epoch = epoch;
+        tlb_epoch = epoch->tlb.load(std::memory_order_acquire);
+        code_epoch = epoch->code.load(std::memory_order_acquire);
+    }
+
+    /// flush hooks for subtypes caching address translation or decoded instructions, defaults do nothing.
+
+    void flush_tlb() {}
+
+    void flush_decode_cache() {}
+
+    /// fallback for addresses address_load or address_store returns nullptr for, so devices can be mapped without
+    /// host memory behind them. true if addr belongs to a device, otherwise a page fault is raised. defaults map no
+    /// device. an amo on a device is one mmio_load followed by one mmio_store.
+
+    template<typename ValT>
+    bool mmio_load(riscv_isa_unused UXLenT addr, riscv_isa_unused ValT &val) { return false; }
+
+    template<typename ValT>
+    bool mmio_store(riscv_isa_unused UXLenT addr, riscv_isa_unused ValT val) { return false; }
+
+    /// flush own caches now and caches of other harts at their next block boundary.
+
+    void shootdown_tlb() {
+        sub_type()->flush_tlb();
+        tlb_epoch = FlushEpoch::bump(flush_epoch->tlb);
+    }
+
+    void shootdown_decode_cache() {
+        sub_type()->flush_decode_cache();
+        code_epoch = FlushEpoch::bump(flush_epoch->code);
+    }
+
+    /// called at block boundaries, one load of each generation if nothing changed.
+    void sync_flush_epoch() {
+        u32 tlb = flush_epoch->tlb.load(std::memory_order_acquire);
+        if (tlb != tlb_epoch) {
+            tlb_epoch = tlb;
+            sub_type()->flush_tlb();
+        }
+
+        u32 code = flush_epoch->code.load(std::memory_order_acquire);
+        if (code != code_epoch) {
+            code_epoch = code;
+            sub_type()->flush_decode_cache();
+        }
+    }
+
+#if defined(__RV_EXTENSION_A__)
+
+    /// harts sharing memory must share the reservation set, set before the hart starts.
+    void set_reservation_set(ReservationSet *set) { reservation_set = set; }
+
+#endif // defined(__RV_EXTENSION_A__)
+
+    /// shared by harts of a machine, set before the hart starts.
+    void set_semihosting(Semihosting *host) { semihosting = host; }
+
+protected:
+    void set_attention(u32 bits) {
+        if ((attention.fetch_or(bits, std::memory_order_release) & ATTENTION_PARKED) != 0) {
+            syscall(SYS_futex, reinterpret_cast<u32 *>(&attention), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+        }
+    }
+
+    /// sleep until an interrupt enabled in mie is pending, stop is requested or the timer deadline is reached.
+    void wait_for_interrupt() {
+        u32 wake = ATTENTION_STOP | ATTENTION_TIMER | (csr_reg[CSRRegT::MIE] & trap::INTERRUPT_MASK);
+        u32 word = attention.load(std::memory_order_acquire);
+
+        while ((word & wake) == 0) {
+            word = attention.fetch_or(ATTENTION_PARKED, std::memory_order_acq_rel) | ATTENTION_PARKED;
+            if ((word & wake) != 0) break;
+
+            // read after parked is set, a deadline made earlier later changes attention and the wait returns.
+            timespec timeout{};
+            u64 deadline = timer_wheel.get_deadline();
+            if (deadline != TimerWheel::NO_DEADLINE) {
+                u64 now = sub_type()->get_time();
+                if (now >= deadline) break;
+
+                u64 ns = static_cast<u128>(deadline - now) * 1000000000u / RISCV_TIME_FREQUENCY + 1;
+                timeout.tv_sec = static_cast<time_t>(ns / 1000000000u);
+                timeout.tv_nsec = static_cast<long>(ns % 1000000000u);
+            }
+
+            // returns at once if attention is no longer word.
+            syscall(SYS_futex, reinterpret_cast<u32 *>(&attention), FUTEX_WAIT_PRIVATE, word,
+                    deadline != TimerWheel::NO_DEADLINE ? &timeout : nullptr, nullptr, 0);
+            word = attention.load(std::memory_order_acquire);
+        }
+
+        attention.fetch_and(~(ATTENTION_PARKED | ATTENTION_TIMER), std::memory_order_relaxed);
+    }
+
+    /// one load if no event is due.
+    bool is_timer_due() {
+        u64 deadline = timer_wheel.get_deadline();
+        return deadline != TimerWheel::NO_DEADLINE && sub_type()->get_time() >= deadline;
+    }
+
+    /// called after mie, mstatus, mideleg or the privilege level changed.
+    void update_attention_mask() {
+        attention_mask = ATTENTION_STOP | ATTENTION_TIMER |
+                         static_cast<u32>(get_interrupt_enabled(csr_reg[CSRRegT::MIE] & trap::INTERRUPT_MASK));
+    }
+
+    void end_block() {
+        if (block_remain > 1) {
+            block_length -= block_remain - 1;
+            block_remain = 1;
+        }
+    }
+
+public:
+    /// end current block after current instruction if anything needs attention, interrupts masked by mie, mstatus
+    /// or mideleg wait without ending blocks.
+    void check_attention() { if ((attention.load(std::memory_order_relaxed) & attention_mask) != 0) end_block(); }
+
+    /// interrupts of pending which may be taken at current privilege level. interrupts not delegated by mideleg
+    /// trap to machine mode, so they are enabled below it or by mstatus.MIE, delegated ones trap to supervisor
+    /// mode, so they are enabled below it or by mstatus.SIE in it.
+    UXLenT get_interrupt_enabled(UXLenT pending) const {
+        UXLenT mstatus = csr_reg[CSRRegT::MSTATUS];
+        UXLenT delegated = csr_reg[CSRRegT::MIDELEG];
+        PrivilegeLevel cur_level = get_privilege_level();
+        UXLenT enabled = 0;
+
+        if (cur_level != PrivilegeLevel::MACHINE_MODE || (mstatus & MSTATUS_MIE) != 0) enabled |= pending & ~delegated;
+#if defined(__RV_SUPERVISOR_MODE__)
+        if (cur_level < PrivilegeLevel::SUPERVISOR_MODE ||
+            (cur_level == PrivilegeLevel::SUPERVISOR_MODE && (mstatus & MSTATUS_SIE) != 0))
+            enabled |= pending & delegated;
+#endif // defined(__RV_SUPERVISOR_MODE__)
+
+        return enabled;
+    }
+
+    /// called at block exit, takes the pending interrupt with highest priority if it is enabled in mie and at current
+    /// privilege level.
+    RetT handle_attention() {
+        u32 word = attention.load(std::memory_order_acquire);
+        if (word == 0) return true;
+        if ((word & ATTENTION_STOP) != 0) return false;
+        if ((word & ATTENTION_TIMER) != 0) attention.fetch_and(~ATTENTION_TIMER, std::memory_order_relaxed);
+
+        UXLenT pending = get_interrupt_enabled(word & trap::INTERRUPT_MASK & csr_reg[CSRRegT::MIE]);
+        if (pending == 0) return true;
+
+        static constexpr trap::InterruptCode priority[] = {
+                trap::MACHINE_EXTERNAL_INTERRUPT, trap::MACHINE_SOFTWARE_INTERRUPT, trap::MACHINE_TIMER_INTERRUPT,
+                trap::SUPERVISOR_EXTERNAL_INTERRUPT, trap::SUPERVISOR_SOFTWARE_INTERRUPT,
+                trap::SUPERVISOR_TIMER_INTERRUPT,
+        };
+
+        hpm_event(HPM_EVENT_TRAP);
+
+        for (trap::InterruptCode code : priority) {
+            if ((pending & (1u << code)) != 0) return sub_type()->interrupt_handler(code);
+        }
+
+        riscv_isa_unreachable("pending interrupt not found!");
+    }
+
+    /// count an event for every hpm counter selecting it.
+    void hpm_event(HPMEvent event, u64 count = 1) {
+        if ((hpm_event_mask & (1u << event)) != 0) hpm_event_count(event, count);
+    }
+
+    /// counters inhibited by mcountinhibit are skipped.
+    void hpm_event_count(HPMEvent event, u64 count) {
+        u32 counters = hpm_event_counter[event] & ~(csr_reg[CSRRegT::MCOUNTINHIBIT] >> CSRRegT::COUNTER_HPM_BASE);
+
+        for (usize i = 0; counters != 0; ++i, counters >>= 1u) {
+            if ((counters & 1u) != 0) hpm_counter[i] += count;
+        }
+    }
+
+    void set_deterministic(bool val) { deterministic = val; }
+
+    bool is_deterministic() const { return deterministic; }
+
+    /// default time source, host monotonic clock scaled to RISCV_TIME_FREQUENCY, or one tick per retired
+    /// instruction in deterministic mode.
+    u64 get_time() const {
+        if (deterministic) return get_instret();
+
+        u64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        return static_cast<u128>(ns) * RISCV_TIME_FREQUENCY / 1000000000u;
+    }
+
     void internal_interrupt_action(UXLenT interrupt, UXLenT trap_value) {
         csr_reg[CSRRegT::SCAUSE] = interrupt;
         csr_reg[CSRRegT::STVAL] = trap_value;
@@ -233,7 +564,7 @@ public:
 
     RetT illegal_instruction(const Instruction *inst) {
         return internal_interrupt(trap::ILLEGAL_INSTRUCTION,
-                                  *reinterpret_cast<const UXLenT *>(inst));
+                                  static_cast<UXLenT>(*reinterpret_cast<const ILenT *>(inst)));
     }
 
     RetT visit_lui_inst(const LUIInst *inst) {
@@ -264,6 +595,8 @@ public:
         UXLenT target = imm + sub_type()->get_pc();
         UXLenT save = sub_type()->get_pc() + JALInst::INST_WIDTH;
 
+        if (imm <= 0) check_attention();
+
         if (!sub_type()->jump_to_addr(target)) { return false; }
         if (rd != 0) { set_x(rd, save); }
 
@@ -400,23 +733,70 @@ public:
     }
 
     RetT visit_ecall_inst(riscv_isa_unused const ECALLInst *inst) {
-        switch (cur_level) {
-#if defined(__RV_USER_MODE__)
-            case PrivilegeLevel::USER_MODE:
-                return internal_interrupt(trap::U_MODE_ENVIRONMENT_CALL, 0);
-#endif
-#if defined(__RV_SUPERVISOR_MODE__)
-            case PrivilegeLevel::SUPERVISOR_MODE:
-                return internal_interrupt(trap::S_MODE_ENVIRONMENT_CALL, 0);
-#endif
-            case PrivilegeLevel::MACHINE_MODE:
-                return internal_interrupt(trap::M_MODE_ENVIRONMENT_CALL, 0);
-            default:
-                riscv_isa_unreachable("unrecognized privilege mode!");
+        return internal_interrupt(context->ecall_cause, 0);
+    }
+
+    /// weakest host fence ordering predecessor set before successor set, device input and output count as reads
+    /// and writes. only a write before a read needs a full fence, which fence.tso leaves out.
+    RetT visit_fence_inst(const FENCEInst *inst) {
+        bool pred_read = inst->get_pr() || inst->get_pi(), pred_write = inst->get_pw() || inst->get_po();
+        bool succ_read = inst->get_sr() || inst->get_si(), succ_write = inst->get_sw() || inst->get_so();
+
+        if (pred_write && succ_read && inst->get_fm() != FENCE_TSO) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        } else {
+            bool acquire = pred_read && (succ_read || succ_write);
+            bool release = succ_write && (pred_read || pred_write);
+
+            if (acquire && release) std::atomic_thread_fence(std::memory_order_acq_rel);
+            else if (acquire) std::atomic_thread_fence(std::memory_order_acquire);
+            else if (release) std::atomic_thread_fence(std::memory_order_release);
         }
+
+        sub_type()->inc_pc(FENCEInst::INST_WIDTH);
+        return true;
+    }
+
+    /// the hart sleeps until woken by raise_interrupt or request_stop. in deterministic mode other harts take turns
+    /// on the same thread, so wfi only ends the block.
+    RetT visit_wfi_inst(riscv_isa_unused const WFIInst *inst) {
+        sub_type()->inc_pc(WFIInst::INST_WIDTH);
+
+        if (!deterministic) wait_for_interrupt();
+        if (is_timer_due()) end_block();
+        else check_attention();
+
+        return true;
+    }
+
+#if defined(__RV_SUPERVISOR_MODE__)
+
+    /// every address space of every hart is flushed, address and asid are not looked at.
+    RetT visit_sfencevma_inst(const SFENCEVAMInst *inst) {
+        if (context->level < PrivilegeLevel::SUPERVISOR_MODE) return sub_type()->illegal_instruction(inst);
+
+        shootdown_tlb();
+
+        sub_type()->inc_pc(SFENCEVAMInst::INST_WIDTH);
+        return true;
+    }
+
+#endif // defined(__RV_SUPERVISOR_MODE__)
+#if defined(__RV_EXTENSION_ZIFENCEI__)
+
+    RetT visit_fencei_inst(riscv_isa_unused const FENCEIInst *inst) {
+        shootdown_decode_cache();
+
+        sub_type()->inc_pc(FENCEIInst::INST_WIDTH);
+        return true;
     }
 
+#endif // defined(__RV_EXTENSION_ZIFENCEI__)
+
+    /// the semihosting sequence is recognized here, so a call never goes through the trap path.
     RetT visit_ebreak_inst(riscv_isa_unused const EBREAKInst *inst) {
+        if (semihosting != nullptr && semihosting->is_call(*sub_type())) return semihosting->call(*sub_type());
+
         return internal_interrupt(trap::BREAKPOINT, sub_type()->get_pc());
     }
 
@@ -472,67 +852,105 @@ public:
             return sub_type()->internal_interrupt(trap::STORE_AMO_ACCESS_FAULT, addr);
         }
 
-        auto *ptr = sub_type()->template address_store<std::atomic<ValT>>(addr);
-        if (ptr == nullptr) {
-            return sub_type()->internal_interrupt(trap::STORE_AMO_PAGE_FAULT, addr);
+        ValT ret;
+        auto *ptr = sub_type()->template address_store<ValT>(addr);
+        if (ptr != nullptr) {
+            reservation_set->invalidate(ptr);
+            ret = OP::op(ptr, rs2_value, operators::memory_order(inst->get_aq(), inst->get_rl()));
+        } else {
+            // device access, the operation is applied to a local copy between one load and one store.
+            ValT val;
+            if (!sub_type()->template mmio_load<ValT>(addr, val)) {
+                return sub_type()->internal_interrupt(trap::STORE_AMO_PAGE_FAULT, addr);
+            }
+
+            ret = OP::op(&val, rs2_value, std::memory_order_relaxed);
+            if (!sub_type()->template mmio_store<ValT>(addr, val)) {
+                return sub_type()->internal_interrupt(trap::STORE_AMO_PAGE_FAULT, addr);
+            }
         }
 
-        set_x(rd, OP::op(ptr, rs2_value));
+        set_x(rd, ret);
+
+        hpm_event(HPM_EVENT_STORE);
 
         sub_type()->inc_pc(InstT::INST_WIDTH);
         return true;
     }
 
-    // todo: only comparing the value, memory ordering.
-    RetT visit_lrw_inst(const LRWInst *inst) {
-        typename LRWInst::UInnerT rd = inst->get_rd();
-        typename LRWInst::UInnerT rs1 = inst->get_rs1();
+    /// ValT is signed, so loaded value is sign extended. lr and sc need memory behind the address, devices are not
+    /// reservable and raise page fault like unmapped addresses.
+    template<typename ValT, typename InstT>
+    RetT operate_load_reserved(const InstT *inst) {
+        static_assert(sizeof(ValT) <= sizeof(UXLenT), "load width exceed bit width!");
+
+        typename InstT::UInnerT rd = inst->get_rd();
+        typename InstT::UInnerT rs1 = inst->get_rs1();
         UXLenT addr = sub_type()->get_x(rs1);
 
-        if ((addr & (sizeof(u32) - 1)) != 0) {
+        if ((addr & (sizeof(ValT) - 1)) != 0) {
             return sub_type()->internal_interrupt(trap::LOAD_ACCESS_FAULT, addr);
         }
 
-        auto *ptr = sub_type()->template address_load<u32>(addr);
+        auto *ptr = sub_type()->template address_load<ValT>(addr);
         if (ptr == nullptr) {
             return sub_type()->internal_interrupt(trap::LOAD_PAGE_FAULT, addr);
         } else {
-            auto value = *ptr;
-            reserve_address = addr;
+            reserve_tag = reservation_set->reserve(ptr);
+            ValT value = guest_atomic::load(
+                    ptr, operators::memory_order_load(operators::memory_order(inst->get_aq(), inst->get_rl())));
+            reserve_ptr = ptr;
             reserve_value = value;
             if (rd != 0) { set_x(rd, value); }
         }
 
-        sub_type()->inc_pc(LRWInst::INST_WIDTH);
+        hpm_event(HPM_EVENT_LOAD);
+
+        sub_type()->inc_pc(InstT::INST_WIDTH);
         return true;
     }
 
-    RetT visit_scw_inst(const SCWInst *inst) {
-        typename SCWInst::UInnerT rd = inst->get_rd();
-        typename SCWInst::UInnerT rs1 = inst->get_rs1();
-        typename SCWInst::UInnerT rs2 = inst->get_rs2();
+    template<typename ValT, typename InstT>
+    RetT operate_store_conditional(const InstT *inst) {
+        static_assert(sizeof(ValT) <= sizeof(UXLenT), "store width exceed bit width!");
+
+        typename InstT::UInnerT rd = inst->get_rd();
+        typename InstT::UInnerT rs1 = inst->get_rs1();
+        typename InstT::UInnerT rs2 = inst->get_rs2();
         UXLenT addr = sub_type()->get_x(rs1);
 
-        if ((addr & (sizeof(u32) - 1)) != 0) {
+        if ((addr & (sizeof(ValT) - 1)) != 0) {
             return sub_type()->internal_interrupt(trap::STORE_AMO_ACCESS_FAULT, addr);
         }
 
-        auto *ptr = sub_type()->template address_store<std::atomic<u32>>(addr);
+        auto *ptr = sub_type()->template address_store<ValT>(addr);
         if (ptr == nullptr) {
             return sub_type()->internal_interrupt(trap::STORE_AMO_PAGE_FAULT, addr);
         } else {
-            if (reserve_address == addr &&
-                ptr->compare_exchange_weak(reserve_value, sub_type()->get_x(rs2))) {
+            ValT expected = static_cast<ValT>(reserve_value);
+            std::memory_order order = operators::memory_order(inst->get_aq(), inst->get_rl());
+
+            if (reserve_ptr == ptr && reservation_set->consume(ptr, reserve_tag) &&
+                guest_atomic::compare_exchange_strong(ptr, expected, static_cast<ValT>(sub_type()->get_x(rs2)), order,
+                                                      operators::memory_order_load(order))) {
                 if (rd != 0) { set_x(rd, 0); }
             } else {
                 if (rd != 0) { set_x(rd, 1); }
             }
+
+            reserve_ptr = nullptr;
         }
 
-        sub_type()->inc_pc(SCWInst::INST_WIDTH);
+        hpm_event(HPM_EVENT_STORE);
+
+        sub_type()->inc_pc(InstT::INST_WIDTH);
         return true;
     }
 
+    RetT visit_lrw_inst(const LRWInst *inst) { return operate_load_reserved<i32>(inst); }
+
+    RetT visit_scw_inst(const SCWInst *inst) { return operate_store_conditional<i32>(inst); }
+
     RetT visit_amoswapw_inst(const AMOSWAPWInst *inst) {
         return operate_atomic<typename operators::AMOSWAP<xlen_32_trait>>(inst);
     }
@@ -569,6 +987,50 @@ public:
         return operate_atomic<typename operators::AMOMAXU<xlen_32_trait>>(inst);
     }
 
+#if __RV_BIT_WIDTH__ == 64
+
+    RetT visit_lrd_inst(const LRDInst *inst) { return operate_load_reserved<i64>(inst); }
+
+    RetT visit_scd_inst(const SCDInst *inst) { return operate_store_conditional<i64>(inst); }
+
+    RetT visit_amoswapd_inst(const AMOSWAPDInst *inst) {
+        return operate_atomic<typename operators::AMOSWAP<xlen_64_trait>>(inst);
+    }
+
+    RetT visit_amoaddd_inst(const AMOADDDInst *inst) {
+        return operate_atomic<typename operators::AMOADD<xlen_64_trait>>(inst);
+    }
+
+    RetT visit_amoxord_inst(const AMOXORDInst *inst) {
+        return operate_atomic<typename operators::AMOXOR<xlen_64_trait>>(inst);
+    }
+
+    RetT visit_amoandd_inst(const AMOANDDInst *inst) {
+        return operate_atomic<typename operators::AMOAND<xlen_64_trait>>(inst);
+    }
+
+    RetT visit_amoord_inst(const AMOORDInst *inst) {
+        return operate_atomic<typename operators::AMOOR<xlen_64_trait>>(inst);
+    }
+
+    RetT visit_amomind_inst(const AMOMINDInst *inst) {
+        return operate_atomic<typename operators::AMOMIN<xlen_64_trait>>(inst);
+    }
+
+    RetT visit_amomaxd_inst(const AMOMAXDInst *inst) {
+        return operate_atomic<typename operators::AMOMAX<xlen_64_trait>>(inst);
+    }
+
+    RetT visit_amominud_inst(const AMOMINUDInst *inst) {
+        return operate_atomic<typename operators::AMOMINU<xlen_64_trait>>(inst);
+    }
+
+    RetT visit_amomaxud_inst(const AMOMAXUDInst *inst) {
+        return operate_atomic<typename operators::AMOMAXU<xlen_64_trait>>(inst);
+    }
+
+#endif // __RV_BIT_WIDTH__ == 64
+
 #endif // defined(__RV_EXTENSION_A__)
 #if __RV_BIT_WIDTH__ == 64
 
@@ -668,11 +1130,131 @@ private:
 
     RetT set_csr(usize index, UXLenT val) { return _set_csr_reg_table[index](this, val); }
 
-    usize check_csr(usize num) {
-        if (CSRRegT::get_privilege_bits(num) > cur_level) {
-            return CSRRegT::CSR_REGISTER_NUM;
+    /// counters are computed only when read, the time is taken from get_time of the subtype.
+    UXLenT get_counter_csr(usize num) {
+        u64 val;
+
+        switch (CSRRegT::get_counter_bits(num)) {
+            case CSRRegT::COUNTER_CYCLE:
+                val = sub_type()->get_cycle();
+                break;
+            case CSRRegT::COUNTER_TIME:
+                val = sub_type()->get_time();
+                break;
+            case CSRRegT::COUNTER_INSTRET:
+                val = sub_type()->get_instret();
+                break;
+            default:
+                val = hpm_counter[CSRRegT::get_counter_bits(num) - CSRRegT::COUNTER_HPM_BASE];
+                break;
+        }
+
+        return static_cast<UXLenT>(CSRRegT::is_counter_high_half(num) ? val >> 32u : val);
+    }
+
+    /// the write takes effect after the writing instruction retired.
+    RetT set_counter_csr(usize num, UXLenT val) {
+        if (CSRRegT::is_user_counter(num)) return false;
+
+        u64 cur;
+        u64 next;
+
+        switch (CSRRegT::get_counter_bits(num)) {
+            case CSRRegT::COUNTER_CYCLE:
+                cur = sub_type()->get_cycle() + 1;
+                break;
+            case CSRRegT::COUNTER_INSTRET:
+                cur = sub_type()->get_instret() + 1;
+                break;
+            case CSRRegT::COUNTER_TIME:
+                return false;
+            default:
+                cur = hpm_counter[CSRRegT::get_counter_bits(num) - CSRRegT::COUNTER_HPM_BASE];
+                break;
+        }
+
+        if (CSRRegT::is_counter_high_half(num)) {
+            next = (static_cast<u64>(val) << 32u) | (cur & bits_mask<u64, 32, 0>::val);
+        } else if (XLEN == 32) {
+            next = (cur & ~bits_mask<u64, 32, 0>::val) | val;
+        } else {
+            next = val;
+        }
+
+        switch (CSRRegT::get_counter_bits(num)) {
+            case CSRRegT::COUNTER_CYCLE:
+                sub_type()->set_cycle(next - 1);
+                break;
+            case CSRRegT::COUNTER_INSTRET:
+                sub_type()->set_instret(next - 1);
+                break;
+            default:
+                hpm_counter[CSRRegT::get_counter_bits(num) - CSRRegT::COUNTER_HPM_BASE] = next;
+                break;
+        }
+
+        return true;
+    }
+
+    /// selector is kept in csr register, the event to counter map is rebuilt on every write.
+    RetT set_hpm_event_csr(usize index, usize num, UXLenT val) {
+        usize counter = get_bits<usize, 5, 0>(num) - CSRRegT::COUNTER_HPM_BASE;
+
+        csr_reg[index] = val;
+
+        for (usize i = 0; i < HPM_EVENT_NUM; ++i) hpm_event_counter[i] &= ~(1u << counter);
+        if (val != HPM_EVENT_NONE && val < HPM_EVENT_NUM) hpm_event_counter[val] |= 1u << counter;
+
+        hpm_event_mask = 0;
+        for (usize i = 0; i < HPM_EVENT_NUM; ++i) if (hpm_event_counter[i] != 0) hpm_event_mask |= 1u << i;
+
+        return true;
+    }
+
+    /// supervisor view only shows interrupts delegated by mideleg.
+    UXLenT get_interrupt_pending_mask(usize num) {
+        if (num == 0x344) return trap::INTERRUPT_MASK;
+        return trap::SUPERVISOR_INTERRUPT_MASK & csr_reg[CSRRegT::MIDELEG];
+    }
+
+    UXLenT get_interrupt_pending_csr(usize num) {
+        return attention.load(std::memory_order_acquire) & get_interrupt_pending_mask(num);
+    }
+
+    /// only software is able to write supervisor level pending bits, and ssip through sip.
+    RetT set_interrupt_pending_csr(usize num, UXLenT val) {
+        u32 mask = get_interrupt_pending_mask(num) &
+                   (num == 0x344 ? trap::SUPERVISOR_INTERRUPT_MASK : 1u << trap::SUPERVISOR_SOFTWARE_INTERRUPT);
+        u32 word = attention.load(std::memory_order_relaxed);
+
+        while (!attention.compare_exchange_weak(word, (word & ~mask) | (val & mask), std::memory_order_acq_rel)) {}
+
+        check_attention();
+
+        return true;
+    }
+
+    /// the write may unmask a pending interrupt, which is then taken after the writing instruction.
+    RetT set_interrupt_enable_csr(usize index, UXLenT val) {
+        RetT ret = sub_type()->set_csr_reg(index, val);
+
+        update_attention_mask();
+        check_attention();
+
+        return ret;
+    }
+
+    using CSRInfo = typename CSRRegT::CSRInfo;
+
+    /// one table lookup, nullptr is returned if csr is not defined or not accessible in current privilege level.
+    const CSRInfo *check_csr(usize num) {
+        riscv_isa_assert(num < CSRRegT::CSR_ADDRESS_NUM);
+        const CSRInfo &info = context->csr_table[num];
+
+        if (info.index == CSRRegT::CSR_REGISTER_NUM) {
+            return nullptr;
         } else {
-            return CSRRegT::get_index(num);
+            return &info;
         }
     }
 
@@ -686,7 +1268,11 @@ public:
 ///     }
 
 #define _riscv_isa_get_csr(NAME, name, num) \
-        UXLenT get_##name##_csr_reg() { return sub_type()->get_csr_reg(CSRRegT::NAME); }
+        UXLenT get_##name##_csr_reg() { \
+            if (CSRRegT::is_counter(num)) return get_counter_csr(num); \
+            if (CSRRegT::is_interrupt_pending(num)) return get_interrupt_pending_csr(num); \
+            return sub_type()->get_csr_reg(CSRRegT::NAME); \
+        }
 
     riscv_isa_csr_reg_map(_riscv_isa_get_csr)
 
@@ -701,7 +1287,13 @@ public:
 ///     }
 
 #define _riscv_isa_set_csr(NAME, name, num) \
-        RetT set_##name##_csr_reg(UXLenT val) { return sub_type()->set_csr_reg(CSRRegT::NAME, val); }
+        RetT set_##name##_csr_reg(UXLenT val) { \
+            if (CSRRegT::is_counter(num)) return set_counter_csr(num, val); \
+            if (CSRRegT::is_hpm_event(num)) return set_hpm_event_csr(CSRRegT::NAME, num, val); \
+            if (CSRRegT::is_interrupt_pending(num)) return set_interrupt_pending_csr(num, val); \
+            if (CSRRegT::is_interrupt_enable(num)) return set_interrupt_enable_csr(CSRRegT::NAME, val); \
+            return sub_type()->set_csr_reg(CSRRegT::NAME, val); \
+        }
 
     riscv_isa_csr_reg_map(_riscv_isa_set_csr)
 
@@ -712,16 +1304,15 @@ public:
 
         UInnerT rd = inst->get_rd();
         UInnerT rs1 = inst->get_rs1();
-        UInnerT csr = inst->get_csr();
 
-        UInnerT index = check_csr(csr);
-        if (index >= CSRRegT::CSR_REGISTER_NUM) {
+        const CSRInfo *info = check_csr(inst->get_csr());
+        if (info == nullptr || info->read_only) {
             return illegal_instruction(inst);
         }
 
-        if (rd != 0) { set_x(rd, get_csr(index)); }
+        if (rd != 0) { set_x(rd, get_csr(info->index)); }
 
-        if (!set_csr(index, sub_type()->get_x(rs1))) {
+        if (!set_csr(info->index, sub_type()->get_x(rs1))) {
             return illegal_instruction(inst);
         }
 
@@ -735,22 +1326,21 @@ public:
 
         UInnerT rd = inst->get_rd();
         UInnerT rs1 = inst->get_rs1();
-        UInnerT csr = inst->get_csr();
 
-        UInnerT index = check_csr(csr);
-        if (index >= CSRRegT::CSR_REGISTER_NUM) {
+        const CSRInfo *info = check_csr(inst->get_csr());
+        if (info == nullptr) {
             return illegal_instruction(inst);
         }
 
-        UXLenT csr_val = get_csr(index);
+        UXLenT csr_val = get_csr(info->index);
         if (rs1 != 0) {
-            if (CSRRegT::get_read_write_bits(csr) == CSRRegT::READ_ONLY_BITS) {
+            if (info->read_only) {
                 return illegal_instruction(inst);
             }
 
             if (rd != 0) { set_x(rd, csr_val); }
 
-            if (!set_csr(index, csr_val | sub_type()->get_x(rs1))) {
+            if (!set_csr(info->index, csr_val | sub_type()->get_x(rs1))) {
                 return illegal_instruction(inst);
             }
         } else {
@@ -767,22 +1357,21 @@ public:
 
         UInnerT rd = inst->get_rd();
         UInnerT rs1 = inst->get_rs1();
-        UInnerT csr = inst->get_csr();
 
-        UInnerT index = check_csr(csr);
-        if (index >= CSRRegT::CSR_REGISTER_NUM) {
+        const CSRInfo *info = check_csr(inst->get_csr());
+        if (info == nullptr) {
             return illegal_instruction(inst);
         }
 
-        UXLenT csr_val = get_csr(index);
+        UXLenT csr_val = get_csr(info->index);
         if (rs1 != 0) {
-            if (CSRRegT::get_read_write_bits(csr) == CSRRegT::READ_ONLY_BITS) {
+            if (info->read_only) {
                 return illegal_instruction(inst);
             }
 
             if (rd != 0) { set_x(rd, csr_val); }
 
-            if (!set_csr(index, csr_val & ~sub_type()->get_x(rs1))) {
+            if (!set_csr(info->index, csr_val & ~sub_type()->get_x(rs1))) {
                 return illegal_instruction(inst);
             }
         } else {
@@ -799,16 +1388,15 @@ public:
 
         UInnerT rd = inst->get_rd();
         UInnerT imm = inst->get_rs1();
-        UInnerT csr = inst->get_csr();
 
-        UInnerT index = check_csr(csr);
-        if (index >= CSRRegT::CSR_REGISTER_NUM) {
+        const CSRInfo *info = check_csr(inst->get_csr());
+        if (info == nullptr || info->read_only) {
             return illegal_instruction(inst);
         }
 
-        if (rd != 0) { set_x(rd, get_csr(index)); }
+        if (rd != 0) { set_x(rd, get_csr(info->index)); }
 
-        if (!set_csr(index, imm)) {
+        if (!set_csr(info->index, imm)) {
             return illegal_instruction(inst);
         }
 
@@ -822,23 +1410,22 @@ public:
 
         UInnerT rd = inst->get_rd();
         UInnerT imm = inst->get_rs1();
-        UInnerT csr = inst->get_csr();
 
-        UInnerT index = check_csr(csr);
-        if (index >= CSRRegT::CSR_REGISTER_NUM) {
+        const CSRInfo *info = check_csr(inst->get_csr());
+        if (info == nullptr) {
             return illegal_instruction(inst);
         }
 
-        UXLenT csr_val = get_csr(index);
+        UXLenT csr_val = get_csr(info->index);
 
         if (imm != 0) {
-            if (CSRRegT::get_read_write_bits(csr) == CSRRegT::READ_ONLY_BITS) {
+            if (info->read_only) {
                 return illegal_instruction(inst);
             }
 
             if (rd != 0) { set_x(rd, csr_val); }
 
-            if (!set_csr(index, csr_val | imm)) {
+            if (!set_csr(info->index, csr_val | imm)) {
                 return illegal_instruction(inst);
             }
         } else {
@@ -855,22 +1442,21 @@ public:
 
         UInnerT rd = inst->get_rd();
         UInnerT imm = inst->get_rs1();
-        UInnerT csr = inst->get_csr();
 
-        UInnerT index = check_csr(csr);
-        if (index >= CSRRegT::CSR_REGISTER_NUM) {
+        const CSRInfo *info = check_csr(inst->get_csr());
+        if (info == nullptr) {
             return illegal_instruction(inst);
         }
 
-        UXLenT csr_val = get_csr(index);
+        UXLenT csr_val = get_csr(info->index);
         if (imm != 0) {
-            if (CSRRegT::get_read_write_bits(csr) == CSRRegT::READ_ONLY_BITS) {
+            if (info->read_only) {
                 return illegal_instruction(inst);
             }
 
             if (rd != 0) { set_x(rd, csr_val); }
 
-            if (!set_csr(index, csr_val & ~imm)) {
+            if (!set_csr(info->index, csr_val & ~imm)) {
                 return illegal_instruction(inst);
             }
         } else {
@@ -1038,7 +1624,96 @@ public:
         return ret;
     }
 
-    void start() { while (sub_type()->visit() || sub_type()->trap_handler()) {}}
+    RetT supervisor_software_interrupt_handler() {
+        std::cerr << "Supervisor software interrupt at " << std::hex << sub_type()->get_pc() << std::dec << std::endl;
+        return false;
+    }
+
+    RetT machine_software_interrupt_handler() {
+        std::cerr << "Machine software interrupt at " << std::hex << sub_type()->get_pc() << std::dec << std::endl;
+        return false;
+    }
+
+    RetT supervisor_timer_interrupt_handler() {
+        std::cerr << "Supervisor timer interrupt at " << std::hex << sub_type()->get_pc() << std::dec << std::endl;
+        return false;
+    }
+
+    RetT machine_timer_interrupt_handler() {
+        std::cerr << "Machine timer interrupt at " << std::hex << sub_type()->get_pc() << std::dec << std::endl;
+        return false;
+    }
+
+    RetT supervisor_external_interrupt_handler() {
+        std::cerr << "Supervisor external interrupt at " << std::hex << sub_type()->get_pc() << std::dec << std::endl;
+        return false;
+    }
+
+    RetT machine_external_interrupt_handler() {
+        std::cerr << "Machine external interrupt at " << std::hex << sub_type()->get_pc() << std::dec << std::endl;
+        return false;
+    }
+
+    RetT interrupt_handler(UXLenT code) {
+        switch (code) {
+            case trap::SUPERVISOR_SOFTWARE_INTERRUPT:
+                return sub_type()->supervisor_software_interrupt_handler();
+            case trap::MACHINE_SOFTWARE_INTERRUPT:
+                return sub_type()->machine_software_interrupt_handler();
+            case trap::SUPERVISOR_TIMER_INTERRUPT:
+                return sub_type()->supervisor_timer_interrupt_handler();
+            case trap::MACHINE_TIMER_INTERRUPT:
+                return sub_type()->machine_timer_interrupt_handler();
+            case trap::SUPERVISOR_EXTERNAL_INTERRUPT:
+                return sub_type()->supervisor_external_interrupt_handler();
+            case trap::MACHINE_EXTERNAL_INTERRUPT:
+                return sub_type()->machine_external_interrupt_handler();
+            default:
+                riscv_isa_unreachable("unknown interrupt code!");
+        }
+    }
+
+    /// execute at most budget instructions as one block, false is returned if the hart stopped. an instruction
+    /// which trapped is not retired, it still takes one from budget. timer events due are expired at block exit,
+    /// in deterministic mode the block also ends at the timer deadline, so events expire at their exact instret.
+    RetT run(usize budget) {
+        RetT ret = true;
+
+        sync_flush_epoch();
+        // subtypes may have written mstatus or mie directly, as trap entry and return do.
+        update_attention_mask();
+
+        if (deterministic) {
+            u64 deadline = timer_wheel.get_deadline(), now = sub_type()->get_time();
+            if (deadline > now && deadline - now < budget) budget = static_cast<usize>(deadline - now);
+        }
+
+        block_length = budget;
+        block_remain = budget;
+
+        for (; block_remain != 0; --block_remain) {
+            if (!sub_type()->visit()) {
+                hpm_event(HPM_EVENT_TRAP);
+
+                if (!sub_type()->trap_handler()) {
+                    ret = false;
+                    break;
+                }
+
+                --block_length;
+            }
+        }
+
+        instret_offset += block_length - block_remain;
+        block_length = 0;
+        block_remain = 0;
+
+        if (is_timer_due()) timer_wheel.advance(sub_type()->get_time());
+
+        return ret && handle_attention();
+    }
+
+    void start() { while (run(BLOCK_BUDGET)) {} }
 };
 
 template<typename SubT, typename xlen>
@@ -1056,6 +1731,18 @@ typename Hart<SubT, xlen>::RetT (*const Hart<SubT, xlen>::_set_csr_reg_table[])(
         riscv_isa_csr_reg_map(_riscv_isa_set_csr_table)
 #undef _riscv_isa_set_csr_table
 };
+
+template<typename SubT, typename xlen>
+const typename Hart<SubT, xlen>::PrivilegeContext Hart<SubT, xlen>::PRIVILEGE_CONTEXT[] = {
+        {static_cast<PrivilegeLevel>(0b00), trap::U_MODE_ENVIRONMENT_CALL,
+         CSRRegT::template CSRTable<static_cast<PrivilegeLevel>(0b00)>::inner},
+        {static_cast<PrivilegeLevel>(0b01), trap::S_MODE_ENVIRONMENT_CALL,
+         CSRRegT::template CSRTable<static_cast<PrivilegeLevel>(0b01)>::inner},
+        {static_cast<PrivilegeLevel>(0b01), trap::S_MODE_ENVIRONMENT_CALL,
+         CSRRegT::template CSRTable<static_cast<PrivilegeLevel>(0b01)>::inner},
+        {static_cast<PrivilegeLevel>(0b11), trap::M_MODE_ENVIRONMENT_CALL,
+         CSRRegT::template CSRTable<static_cast<PrivilegeLevel>(0b11)>::inner},
+};
 }
 
 
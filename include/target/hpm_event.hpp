@@ -0,0 +1,27 @@
+#ifndef RISCV_ISA_HPM_EVENT_HPP
+#define RISCV_ISA_HPM_EVENT_HPP
+
+
+#include "riscv_isa_utility.hpp"
+
+
+namespace riscv_isa {
+    /// event selector values for mhpmevent3 - mhpmevent31. zero means the counter counts nothing, values not listed
+    /// here are treated as zero.
+    ///
+    /// loads, stores, taken branches and traps, exceptions and interrupts alike, are raised by the hart itself. tlb
+    /// misses and decode cache misses are raised by the subtype which owns those structures, through Hart::hpm_event.
+    enum HPMEvent : usize {
+        HPM_EVENT_NONE = 0,
+        HPM_EVENT_LOAD = 1,
+        HPM_EVENT_STORE = 2,
+        HPM_EVENT_BRANCH_TAKEN = 3,
+        HPM_EVENT_TRAP = 4,
+        HPM_EVENT_TLB_MISS = 5,
+        HPM_EVENT_DECODE_CACHE_MISS = 6,
+        HPM_EVENT_NUM,
+    };
+}
+
+
+#endif //RISCV_ISA_HPM_EVENT_HPP
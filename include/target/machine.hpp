@@ -0,0 +1,215 @@
+#ifndef RISCV_ISA_MACHINE_HPP
+#define RISCV_ISA_MACHINE_HPP
+
+
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "riscv_isa_utility.hpp"
+#include "reservation_set.hpp"
+#include "flush_epoch.hpp"
+#include "device_tree.hpp"
+#include "semihosting.hpp"
+
+
+namespace riscv_isa {
+    /// owns a group of harts running on their own host threads. extra constructor arguments are passed by reference
+    /// to every hart after (hart_id, pc, reg), so guest memory and devices are shared by all of them. harts start
+    /// with zeroed registers of their own, set them by get_hart(i).set_x before harts run.
+    ///
+    /// harts are not synchronized with each other, any ordering between them comes from atomic guest memory
+    /// accesses. stop only sets a bit in the attention word of each hart, so a hart stops at its next block exit.
+    ///
+    /// run_deterministic is the reproducible alternative to start and join, harts take turns on calling thread.
+    ///
+    /// every hart is allocated in its own block of whole pages, so hot state of different harts never shares a
+    /// cache line, and the block can be moved to the memory node of the cpu its thread is pinned to.
+    template<typename HartT>
+    class Machine {
+    public:
+        static constexpr usize DETERMINISTIC_QUANTUM = 0x10000;
+
+        using IntRegT = typename HartT::IntRegT;
+        using XLenT = typename HartT::XLenT;
+        using UXLenT = typename HartT::UXLenT;
+
+    private:
+        struct HartDeleter {
+        public:
+            void operator()(HartT *hart) const {
+                hart->~HartT();
+                free(hart);
+            }
+        };
+
+        ReservationSet reservation_set;
+        FlushEpoch flush_epoch;
+        std::vector<std::unique_ptr<HartT, HartDeleter>> harts;
+        std::vector<std::thread> threads;
+        bool pin_thread;
+
+        static usize get_page_size() { return static_cast<usize>(sysconf(_SC_PAGESIZE)); }
+
+        static usize get_block_size() {
+            return (sizeof(HartT) + get_page_size() - 1) / get_page_size() * get_page_size();
+        }
+
+        /// bind calling thread to host cpu modulo cpu count, then move the block of hart to the memory node of that
+        /// cpu. both only affect performance, failure is not fatal.
+        static void bind(HartT *hart, usize cpu) {
+            usize cpu_num = std::thread::hardware_concurrency();
+            if (cpu_num == 0) return;
+
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu % cpu_num, &set);
+
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+                riscv_isa_warn("pin hart thread failed!");
+                return;
+            }
+
+            unsigned cur_cpu = 0, node = 0;
+            if (syscall(SYS_getcpu, &cur_cpu, &node, nullptr) != 0) return;
+
+            usize page_num = get_block_size() / get_page_size();
+            std::vector<void *> pages(page_num);
+            std::vector<int> nodes(page_num, static_cast<int>(node)), status(page_num);
+            for (usize i = 0; i < page_num; ++i) pages[i] = reinterpret_cast<u8 *>(hart) + i * get_page_size();
+
+            syscall(SYS_move_pages, 0, page_num, pages.data(), nodes.data(), status.data(), MPOL_MF_MOVE);
+        }
+
+    public:
+        template<typename... ArgsT>
+        Machine(usize hart_num, XLenT pc, ArgsT &... args) : pin_thread{true} {
+            IntRegT reg{};
+
+            harts.reserve(hart_num);
+            for (usize i = 0; i < hart_num; ++i) {
+                void *block = nullptr;
+                if (posix_memalign(&block, get_page_size(), get_block_size()) != 0)
+                    riscv_isa_abort("hart allocate failed!");
+
+                harts.emplace_back(new(block) HartT{static_cast<UXLenT>(i), pc, reg, args...});
+                harts.back()->set_flush_epoch(&flush_epoch);
+#if defined(__RV_EXTENSION_A__)
+                harts.back()->set_reservation_set(&reservation_set);
+#endif
+            }
+        }
+
+        Machine(const Machine &other) = delete;
+
+        Machine &operator=(const Machine &other) = delete;
+
+        usize get_hart_num() const { return harts.size(); }
+
+        HartT &get_hart(usize hart_id) { return *harts[hart_id]; }
+
+        void set_pin_thread(bool val) { pin_thread = val; }
+
+        /// every hart executes semihosting calls on host, an exit from any of them stops the whole machine.
+        void set_semihosting(Semihosting *host) {
+            for (auto &hart: harts) hart->set_semihosting(host);
+            if (host != nullptr) host->connect_exit(*this);
+        }
+
+        /// device tree with every hart of machine, isa string taken from the misa harts reset to. memory and devices
+        /// are added by caller, who knows where they are mapped.
+        DeviceTree get_device_tree() const {
+            UXLenT misa = HartT::CSRRegT::MISA_INIT;
+            return DeviceTree{harts.size(), DeviceTree::get_isa_string(misa)};
+        }
+
+        /// copy dtb to guest memory at addr, and hand it to every hart as the boot protocol of riscv kernels asks,
+        /// hart id in a0 and dtb address in a1. call before harts start. MemT is required to implement:
+        ///
+        ///     /// false if range is not in memory.
+        ///     bool memory_copy(UXLenT offset, const void *src, usize length);
+        template<typename MemT>
+        bool load_device_tree(MemT &mem, UXLenT addr, const std::vector<u8> &dtb) {
+            riscv_isa_assert(!is_running());
+
+            if (!mem.memory_copy(addr, dtb.data(), dtb.size())) return false;
+
+            for (usize i = 0; i < harts.size(); ++i) {
+                harts[i]->set_x(IntRegT::A0, static_cast<XLenT>(i));
+                harts[i]->set_x(IntRegT::A1, static_cast<XLenT>(addr));
+            }
+
+            return true;
+        }
+
+        bool is_running() const { return !threads.empty(); }
+
+        /// start every hart on its own thread, harts should not be accessed by caller until join.
+        void start() {
+            riscv_isa_assert(!is_running());
+
+            // every hart is reset before any runs, a hart stopping the machine at once must not be undone.
+            for (auto &hart: harts) {
+                hart->clear_stop();
+                hart->set_deterministic(false);
+            }
+
+            threads.reserve(harts.size());
+            for (usize i = 0; i < harts.size(); ++i) {
+                HartT *hart = harts[i].get();
+                bool pin = pin_thread;
+                threads.emplace_back([hart, i, pin]() {
+                    if (pin) bind(hart, i);
+                    hart->start();
+                });
+            }
+        }
+
+        /// run harts on calling thread until every hart stops. harts take turns in hart id order, each running one
+        /// block of quantum instructions, and time follows retired instructions. so every run of the same guest
+        /// program interleaves the same way. large quantum keeps switching cost close to single hart execution.
+        void run_deterministic(usize quantum = DETERMINISTIC_QUANTUM) {
+            riscv_isa_assert(!is_running());
+
+            std::vector<HartT *> alive;
+            for (auto &hart: harts) {
+                hart->clear_stop();
+                hart->set_deterministic(true);
+                alive.push_back(hart.get());
+            }
+
+            while (!alive.empty()) {
+                for (usize i = 0; i < alive.size();) {
+                    if (alive[i]->run(quantum)) ++i;
+                    else alive.erase(alive.begin() + i);
+                }
+            }
+        }
+
+        /// ask every hart to stop, returns immediately.
+        void stop() { for (auto &hart: harts) hart->request_stop(); }
+
+        /// wait until every hart stops, either by stop or by its own trap handler.
+        void join() {
+            for (auto &thread: threads) thread.join();
+            threads.clear();
+        }
+
+        ~Machine() {
+            if (is_running()) {
+                stop();
+                join();
+            }
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_MACHINE_HPP
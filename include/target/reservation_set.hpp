@@ -0,0 +1,70 @@
+#ifndef RISCV_ISA_RESERVATION_SET_HPP
+#define RISCV_ISA_RESERVATION_SET_HPP
+
+
+#include <atomic>
+#include <cstdint>
+
+#include "riscv_isa_utility.hpp"
+
+
+namespace riscv_isa {
+    /// reservation set for lr/sc shared by all harts of a machine, one slot per host cache line of reserved memory.
+    /// lines hashing to the same slot share it, which can only make sc fail more often.
+    ///
+    /// each slot holds a version number and a reserved bit. lr sets the reserved bit and remembers the slot as tag.
+    /// sc succeeds only if the slot still equals the tag, and bumps the version, so at most one of the harts holding
+    /// a reservation on the line succeeds. other stores bump the version only if the reserved bit is set, a store to a
+    /// line nobody reserved costs one relaxed load.
+    ///
+    /// sc also compares the value read by lr, which covers a store racing with lr itself.
+    class ReservationSet {
+    public:
+        static constexpr usize LINE_BITS = 6;
+        static constexpr usize SLOT_NUM = 4096;
+        static constexpr u32 RESERVED = 1;
+
+    private:
+        std::atomic<u32> slots[SLOT_NUM];
+
+        std::atomic<u32> &get_slot(const void *ptr) {
+            return slots[(reinterpret_cast<uintptr_t>(ptr) >> LINE_BITS) % SLOT_NUM];
+        }
+
+    public:
+        ReservationSet() { for (auto &slot: slots) slot.store(0, std::memory_order_relaxed); }
+
+        ReservationSet(const ReservationSet &other) = delete;
+
+        ReservationSet &operator=(const ReservationSet &other) = delete;
+
+        /// set shared by harts not belonging to any machine.
+        static ReservationSet &get_default() {
+            static ReservationSet set{};
+            return set;
+        }
+
+        /// make reservation on the line of ptr, returns the tag. must be called before reading the value.
+        u32 reserve(const void *ptr) {
+            return get_slot(ptr).fetch_or(RESERVED, std::memory_order_acq_rel) | RESERVED;
+        }
+
+        /// end every reservation on the line, true if the reservation of tag was still valid.
+        bool consume(const void *ptr, u32 tag) {
+            return get_slot(ptr).compare_exchange_strong(tag, tag + 1, std::memory_order_acq_rel,
+                                                         std::memory_order_relaxed);
+        }
+
+        /// must be called before every store which is not a successful sc.
+        void invalidate(const void *ptr) {
+            std::atomic<u32> &slot = get_slot(ptr);
+            u32 tag = slot.load(std::memory_order_relaxed);
+
+            while ((tag & RESERVED) != 0 &&
+                   !slot.compare_exchange_weak(tag, tag + 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {}
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_RESERVATION_SET_HPP
@@ -0,0 +1,461 @@
+#ifndef RISCV_ISA_SEMIHOSTING_HPP
+#define RISCV_ISA_SEMIHOSTING_HPP
+
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "riscv_isa_utility.hpp"
+
+
+namespace riscv_isa {
+    /// host side of riscv semihosting, shared by the harts of a machine. a hart with semihosting set executes the
+    /// semihosting sequence
+    ///
+    ///     slli x0, x0, 0x1f
+    ///     ebreak
+    ///     srai x0, x0, 7
+    ///
+    /// as a call, operation in a0 and argument in a1, instead of taking a breakpoint trap. guest buffers are turned
+    /// into iovecs of host memory, so a call costs one system call whatever its size.
+    ///
+    /// handles returned to the guest index a table of host fds. ":tt" opens the console, which are the fds given
+    /// on construction and are not owned. every other fd is closed with the object.
+    class Semihosting {
+    public:
+        enum : usize {
+            SYS_OPEN = 0x01,
+            SYS_CLOSE = 0x02,
+            SYS_WRITEC = 0x03,
+            SYS_WRITE0 = 0x04,
+            SYS_WRITE = 0x05,
+            SYS_READ = 0x06,
+            SYS_READC = 0x07,
+            SYS_ISERROR = 0x08,
+            SYS_ISTTY = 0x09,
+            SYS_SEEK = 0x0a,
+            SYS_FLEN = 0x0c,
+            SYS_REMOVE = 0x0e,
+            SYS_CLOCK = 0x10,
+            SYS_TIME = 0x11,
+            SYS_ERRNO = 0x13,
+            SYS_EXIT = 0x18,
+            SYS_EXIT_EXTENDED = 0x20,
+        };
+
+        static constexpr u32 SEQUENCE_PREFIX = 0x01f01013; // slli x0, x0, 0x1f
+        static constexpr u32 SEQUENCE_SUFFIX = 0x40705013; // srai x0, x0, 7
+
+        static constexpr u64 ADP_STOPPED_APPLICATION_EXIT = 0x20026;
+
+        static constexpr usize MODE_NUM = 12;
+
+        /// ebreak of the sequence is never compressed.
+        static constexpr usize EBREAK_WIDTH = 4;
+        /// guest memory passed to calls is split at this granularity, the unit of address translation.
+        static constexpr usize GUEST_PAGE = 0x1000;
+
+    private:
+        struct File {
+        public:
+            int fd;
+            bool owned;
+        };
+
+        std::mutex lock;
+        std::vector<File> files;
+        int in_fd, out_fd, err_fd;
+        /// errno of the last failed call of any hart.
+        std::atomic<int> last_errno;
+        std::atomic<bool> exited;
+        std::atomic<int> exit_code;
+        u64 start_time;
+        /// stops every hart sharing this object, nullptr if only the calling hart stops on exit.
+        void *exit_target;
+        void (*exit_stopper)(void *target);
+
+        template<typename TargetT>
+        static void stop_target(void *target) { static_cast<TargetT *>(target)->stop(); }
+
+        i64 add_file(int fd, bool owned) {
+            for (usize i = 0; i < files.size(); ++i) {
+                if (files[i].fd < 0) {
+                    files[i] = File{fd, owned};
+                    return static_cast<i64>(i);
+                }
+            }
+
+            files.push_back(File{fd, owned});
+            return static_cast<i64>(files.size() - 1);
+        }
+
+        /// host fd of handle, -1 if handle is not open.
+        int get_fd(u64 handle) {
+            std::lock_guard<std::mutex> guard{lock};
+            return handle < files.size() ? files[handle].fd : -1;
+        }
+
+        template<typename HartT>
+        static bool fetch_word(HartT &hart, typename HartT::UXLenT addr, u32 &val) {
+            const u16 *low = hart.template address_execute<u16>(addr);
+            const u16 *high = hart.template address_execute<u16>(addr + sizeof(u16));
+            if (low == nullptr || high == nullptr) return false;
+
+            val = *low | static_cast<u32>(*high) << 16u;
+            return true;
+        }
+
+        /// num words of xlen from addr, false if they are not aligned memory.
+        template<typename HartT, typename UXLenT = typename HartT::UXLenT>
+        static bool get_guest_words(HartT &hart, UXLenT addr, UXLenT *words, usize num) {
+            if (addr % sizeof(UXLenT) != 0) return false;
+
+            for (usize i = 0; i < num; ++i) {
+                const UXLenT *ptr = hart.template address_load<UXLenT>(addr + i * sizeof(UXLenT));
+                if (ptr == nullptr) return false;
+                words[i] = *ptr;
+            }
+
+            return true;
+        }
+
+        /// host memory of guest range [addr, addr + length) appended to iov, pages contiguous on host are merged.
+        /// false if any of it is not memory.
+        template<typename HartT, typename UXLenT = typename HartT::UXLenT>
+        static bool get_guest_buffer(HartT &hart, UXLenT addr, UXLenT length, bool write, std::vector<iovec> &iov) {
+            while (length != 0) {
+                UXLenT size = GUEST_PAGE - addr % GUEST_PAGE;
+                if (size > length) size = length;
+
+                u8 *ptr = write ? hart.template address_store<u8>(addr) :
+                          const_cast<u8 *>(hart.template address_load<u8>(addr));
+                if (ptr == nullptr) return false;
+
+                if (!iov.empty() && static_cast<u8 *>(iov.back().iov_base) + iov.back().iov_len == ptr)
+                    iov.back().iov_len += size;
+                else iov.push_back(iovec{ptr, size});
+
+                addr += size;
+                length -= size;
+            }
+
+            return true;
+        }
+
+        template<typename HartT, typename UXLenT = typename HartT::UXLenT>
+        static bool get_guest_string(HartT &hart, UXLenT addr, UXLenT length, std::string &val) {
+            std::vector<iovec> iov;
+            if (!get_guest_buffer(hart, addr, length, false, iov)) return false;
+
+            for (auto &piece: iov) val.append(static_cast<const char *>(piece.iov_base), piece.iov_len);
+            return true;
+        }
+
+        /// null terminated string at addr to the console.
+        template<typename HartT, typename UXLenT = typename HartT::UXLenT>
+        bool write_guest_string(HartT &hart, UXLenT addr) {
+            for (;;) {
+                const u8 *ptr = hart.template address_load<u8>(addr);
+                if (ptr == nullptr) return false;
+
+                UXLenT size = GUEST_PAGE - addr % GUEST_PAGE;
+                const void *end = memchr(ptr, 0, size);
+                if (end != nullptr) size = static_cast<UXLenT>(static_cast<const u8 *>(end) - ptr);
+
+                write_console(ptr, size);
+                if (end != nullptr) return true;
+                addr += size;
+            }
+        }
+
+        /// exit status of SYS_EXIT and SYS_EXIT_EXTENDED. rv32 passes the reason of SYS_EXIT in a1 with no subcode,
+        /// otherwise a1 points to reason and subcode, which is the status of a normal exit.
+        template<typename HartT, typename UXLenT = typename HartT::UXLenT>
+        static bool get_exit_code(HartT &hart, UXLenT op, UXLenT arg, int &code) {
+            UXLenT param[2] = {arg, 0};
+            if ((op == SYS_EXIT_EXTENDED || sizeof(UXLenT) > sizeof(u32)) && !get_guest_words(hart, arg, param, 2))
+                return false;
+
+            code = param[0] == ADP_STOPPED_APPLICATION_EXIT ? static_cast<int>(param[1]) : 1;
+            return true;
+        }
+
+    public:
+        /// fds of the console, owned by caller.
+        explicit Semihosting(int in_fd = STDIN_FILENO, int out_fd = STDOUT_FILENO, int err_fd = STDERR_FILENO) :
+                in_fd{in_fd}, out_fd{out_fd}, err_fd{err_fd}, last_errno{0}, exited{false}, exit_code{0},
+                start_time{get_host_time()}, exit_target{nullptr}, exit_stopper{nullptr} {}
+
+        Semihosting(const Semihosting &other) = delete;
+
+        Semihosting &operator=(const Semihosting &other) = delete;
+
+        /// host monotonic clock in ticks of RISCV_TIME_FREQUENCY, the clock of SYS_CLOCK outside deterministic mode.
+        static u64 get_host_time() {
+            u64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+            return static_cast<u128>(ns) * RISCV_TIME_FREQUENCY / 1000000000u;
+        }
+
+        u64 get_start_time() const { return start_time; }
+
+        /// record error of a call, returns -1.
+        i64 fail(int error) {
+            last_errno.store(error, std::memory_order_relaxed);
+            return -1;
+        }
+
+        /// mode is the index of the fopen mode in "r", "rb", "r+", "r+b", "w", "wb", "w+", "w+b", "a", "ab", "a+",
+        /// "a+b". returns handle, or -1.
+        i64 open(const std::string &name, u64 mode) {
+            static const int FLAGS[] = {O_RDONLY, O_RDWR, O_WRONLY | O_CREAT | O_TRUNC, O_RDWR | O_CREAT | O_TRUNC,
+                                        O_WRONLY | O_CREAT | O_APPEND, O_RDWR | O_CREAT | O_APPEND};
+
+            if (mode >= MODE_NUM) return fail(EINVAL);
+
+            std::lock_guard<std::mutex> guard{lock};
+
+            if (name == ":tt") return add_file(mode < 4 ? in_fd : mode < 8 ? out_fd : err_fd, false);
+
+            int fd = ::open(name.c_str(), FLAGS[mode / 2] | O_CLOEXEC, 0644);
+            if (fd < 0) return fail(errno);
+
+            return add_file(fd, true);
+        }
+
+        i64 close(u64 handle) {
+            std::lock_guard<std::mutex> guard{lock};
+
+            if (handle >= files.size() || files[handle].fd < 0) return fail(EBADF);
+            if (files[handle].owned) ::close(files[handle].fd);
+            files[handle].fd = -1;
+
+            return 0;
+        }
+
+        /// bytes written, or -1. at most IOV_MAX pieces are written, the rest is left to the guest to retry.
+        i64 write(u64 handle, const iovec *iov, usize num) {
+            int fd = get_fd(handle);
+            if (fd < 0) return fail(EBADF);
+
+            ssize_t ret;
+            do {
+                ret = ::writev(fd, iov, static_cast<int>(num < IOV_MAX ? num : IOV_MAX));
+            } while (ret < 0 && errno == EINTR);
+
+            return ret < 0 ? fail(errno) : ret;
+        }
+
+        /// bytes read, or -1.
+        i64 read(u64 handle, const iovec *iov, usize num) {
+            int fd = get_fd(handle);
+            if (fd < 0) return fail(EBADF);
+
+            ssize_t ret;
+            do {
+                ret = ::readv(fd, iov, static_cast<int>(num < IOV_MAX ? num : IOV_MAX));
+            } while (ret < 0 && errno == EINTR);
+
+            return ret < 0 ? fail(errno) : ret;
+        }
+
+        /// SYS_WRITEC and SYS_WRITE0 write to the console.
+        void write_console(const void *data, usize length) {
+            while (length != 0) {
+                ssize_t ret = ::write(out_fd, data, length);
+                if (ret < 0 && errno == EINTR) continue;
+                if (ret <= 0) return;
+
+                data = static_cast<const u8 *>(data) + ret;
+                length -= static_cast<usize>(ret);
+            }
+        }
+
+        /// byte of console input, or -1.
+        i64 read_console() {
+            u8 val;
+            ssize_t ret;
+            do {
+                ret = ::read(in_fd, &val, 1);
+            } while (ret < 0 && errno == EINTR);
+
+            return ret == 1 ? val : fail(ret < 0 ? errno : EIO);
+        }
+
+        /// 1 if handle is a terminal, 0 if not, -1 if it is not open.
+        i64 is_tty(u64 handle) {
+            int fd = get_fd(handle);
+            if (fd < 0) return fail(EBADF);
+
+            return isatty(fd) ? 1 : 0;
+        }
+
+        i64 seek(u64 handle, u64 position) {
+            int fd = get_fd(handle);
+            if (fd < 0) return fail(EBADF);
+
+            return ::lseek(fd, static_cast<off_t>(position), SEEK_SET) < 0 ? fail(errno) : 0;
+        }
+
+        /// length of file, or -1.
+        i64 flen(u64 handle) {
+            int fd = get_fd(handle);
+            if (fd < 0) return fail(EBADF);
+
+            struct stat info{};
+            return fstat(fd, &info) < 0 ? fail(errno) : static_cast<i64>(info.st_size);
+        }
+
+        i64 remove(const std::string &name) { return ::unlink(name.c_str()) < 0 ? fail(errno) : 0; }
+
+        i64 get_errno() const { return last_errno.load(std::memory_order_relaxed); }
+
+        /// on exit target is asked to stop, so an exit of one hart ends all of them. TargetT is required to
+        /// implement:
+        ///
+        ///     /// may be called from any hart thread, returns immediately.
+        ///     void stop();
+        template<typename TargetT>
+        void connect_exit(TargetT &target) {
+            exit_target = &target;
+            exit_stopper = &stop_target<TargetT>;
+        }
+
+        void exit(int code) {
+            exit_code.store(code, std::memory_order_relaxed);
+            exited.store(true, std::memory_order_release);
+            if (exit_stopper != nullptr) exit_stopper(exit_target);
+        }
+
+        bool has_exited() const { return exited.load(std::memory_order_acquire); }
+
+        int get_exit_code() const { return exit_code.load(std::memory_order_relaxed); }
+
+        /// ebreak at pc of hart is the middle of the semihosting sequence.
+        template<typename HartT>
+        static bool is_call(HartT &hart) {
+            typename HartT::UXLenT addr = hart.get_pc();
+            u32 prefix = 0, suffix = 0;
+
+            return fetch_word(hart, addr - 4, prefix) && prefix == SEQUENCE_PREFIX &&
+                   fetch_word(hart, addr + 4, suffix) && suffix == SEQUENCE_SUFFIX;
+        }
+
+        /// execute call of operation a0 with argument a1 for hart, result goes to a0. a call failing returns -1 and
+        /// keeps the host errno for SYS_ERRNO, SYS_WRITE and SYS_READ return the number of bytes not transferred.
+        /// after an exit the hart stops at once, and so does everything connected by connect_exit. HartT is required
+        /// to implement address_load, address_store and address_execute as harts do, and to be a Hart for the rest.
+        template<typename HartT>
+        bool call(HartT &hart) {
+            using XLenT = typename HartT::XLenT;
+            using UXLenT = typename HartT::UXLenT;
+            using IntRegT = typename HartT::IntRegT;
+
+            UXLenT op = hart.get_x(IntRegT::A0), arg = hart.get_x(IntRegT::A1);
+            UXLenT param[3] = {};
+            std::vector<iovec> iov;
+            std::string name;
+            i64 ret = -1;
+            int code = 0;
+
+            switch (op) {
+                case SYS_OPEN:
+                    ret = get_guest_words(hart, arg, param, 3) && get_guest_string(hart, param[0], param[2], name) ?
+                          open(name, param[1]) : fail(EFAULT);
+                    break;
+                case SYS_CLOSE:
+                    ret = get_guest_words(hart, arg, param, 1) ? close(param[0]) : fail(EFAULT);
+                    break;
+                case SYS_WRITEC:
+                    if (get_guest_buffer(hart, arg, UXLenT{1}, false, iov)) write_console(iov[0].iov_base, 1);
+                    ret = 0;
+                    break;
+                case SYS_WRITE0:
+                    ret = write_guest_string(hart, arg) ? 0 : fail(EFAULT);
+                    break;
+                case SYS_WRITE:
+                case SYS_READ:
+                    if (!get_guest_words(hart, arg, param, 3)) {
+                        ret = fail(EFAULT);
+                    } else if (!get_guest_buffer(hart, param[1], param[2], op == SYS_READ, iov)) {
+                        fail(EFAULT);
+                        ret = param[2];
+                    } else {
+                        i64 done = op == SYS_READ ? read(param[0], iov.data(), iov.size()) :
+                                   write(param[0], iov.data(), iov.size());
+                        ret = done < 0 ? param[2] : param[2] - done;
+                    }
+                    break;
+                case SYS_READC:
+                    ret = read_console();
+                    break;
+                case SYS_ISERROR:
+                    ret = get_guest_words(hart, arg, param, 1) ? static_cast<XLenT>(param[0]) < 0 : fail(EFAULT);
+                    break;
+                case SYS_ISTTY:
+                    ret = get_guest_words(hart, arg, param, 1) ? is_tty(param[0]) : fail(EFAULT);
+                    break;
+                case SYS_SEEK:
+                    ret = get_guest_words(hart, arg, param, 2) ? seek(param[0], param[1]) : fail(EFAULT);
+                    break;
+                case SYS_FLEN:
+                    ret = get_guest_words(hart, arg, param, 1) ? flen(param[0]) : fail(EFAULT);
+                    break;
+                case SYS_REMOVE:
+                    ret = get_guest_words(hart, arg, param, 2) && get_guest_string(hart, param[0], param[1], name) ?
+                          remove(name) : fail(EFAULT);
+                    break;
+                case SYS_CLOCK: {
+                    // centiseconds since execution started, in retired instructions in deterministic mode.
+                    u64 now = hart.get_time();
+                    if (!hart.is_deterministic()) now -= start_time;
+                    ret = static_cast<i64>(now / (RISCV_TIME_FREQUENCY / 100));
+                    break;
+                }
+                case SYS_TIME:
+                    ret = static_cast<i64>(time(nullptr));
+                    break;
+                case SYS_ERRNO:
+                    ret = get_errno();
+                    break;
+                case SYS_EXIT:
+                case SYS_EXIT_EXTENDED:
+                    if (get_exit_code(hart, op, arg, code)) {
+                        exit(code);
+                        hart.request_stop();
+                        hart.check_attention();
+                        hart.inc_pc(EBREAK_WIDTH);
+                        return true;
+                    }
+                    ret = fail(EFAULT);
+                    break;
+                default:
+                    ret = fail(ENOSYS);
+                    break;
+            }
+
+            hart.set_x(IntRegT::A0, static_cast<XLenT>(ret));
+            hart.inc_pc(EBREAK_WIDTH);
+            return true;
+        }
+
+        ~Semihosting() {
+            for (auto &file: files)
+                if (file.fd >= 0 && file.owned) ::close(file.fd);
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_SEMIHOSTING_HPP
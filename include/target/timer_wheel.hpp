@@ -0,0 +1,253 @@
+#ifndef RISCV_ISA_TIMER_WHEEL_HPP
+#define RISCV_ISA_TIMER_WHEEL_HPP
+
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "riscv_isa_utility.hpp"
+
+
+namespace riscv_isa {
+    class TimerWheel;
+
+    /// future event of a timer wheel, owned by whoever schedules it and linked into the wheel while pending. it is
+    /// connected to a target, which is required to implement:
+    ///
+    ///     /// called on the thread running the hart owning the wheel, with no lock of the wheel held.
+    ///     void expire(usize id);
+    ///
+    /// an event must not be destroyed while it is pending.
+    class TimerEvent {
+    private:
+        friend class TimerWheel;
+
+        TimerEvent *next;
+        TimerEvent **prev; // next field of previous event or head of slot, nullptr if not pending.
+        usize slot;
+        u64 deadline;
+
+        void *target;
+        usize id;
+        void (*expire)(void *target, usize id);
+
+        template<typename TargetT>
+        static void expire_target(void *target, usize id) { static_cast<TargetT *>(target)->expire(id); }
+
+    public:
+        TimerEvent() : next{nullptr}, prev{nullptr}, slot{0}, deadline{0}, target{nullptr}, id{0}, expire{nullptr} {}
+
+        TimerEvent(const TimerEvent &other) = delete;
+
+        TimerEvent &operator=(const TimerEvent &other) = delete;
+
+        template<typename TargetT>
+        void connect(TargetT &receiver, usize event_id) {
+            target = &receiver;
+            id = event_id;
+            expire = &expire_target<TargetT>;
+        }
+
+        u64 get_deadline() const { return deadline; }
+    };
+
+    /// hierarchical timer wheel of one hart, keyed on the time of the hart, which is retired instructions in
+    /// deterministic mode and scaled host clock otherwise.
+    ///
+    /// level l has SLOT_NUM slots of SLOT_NUM^l ticks each. an event sits in the lowest level whose slot holds its
+    /// deadline and is not the slot current is in, and moves down a level when current enters its slot. with
+    /// LEVEL_NUM levels every u64 deadline has a slot, and a bitmap of occupied slots per level finds the next one
+    /// with a single ctz, so current jumps over idle time instead of ticking through it.
+    ///
+    /// the lower bound of the earliest deadline is published as an atomic word after every change, and the run loop
+    /// of the hart only compares its time with it, so scheduling costs nothing to execution between deadlines. events
+    /// may be scheduled or cancelled from any thread, advance is only called by the owning hart.
+    class TimerWheel {
+    public:
+        static constexpr usize LEVEL_BITS = 6;
+        static constexpr usize SLOT_NUM = 1u << LEVEL_BITS;
+        static constexpr usize LEVEL_NUM = (64 + LEVEL_BITS - 1) / LEVEL_BITS;
+        static constexpr u64 NO_DEADLINE = ~static_cast<u64>(0);
+
+    private:
+        /// information of an expired event copied out of it, so the event can be scheduled again once unlocked.
+        struct Expired {
+        public:
+            void *target;
+            usize id;
+            void (*expire)(void *target, usize id);
+        };
+
+        std::mutex lock;
+        /// events scheduled with a deadline before current, they expire at next advance.
+        TimerEvent *due;
+        TimerEvent *slots[LEVEL_NUM][SLOT_NUM];
+        u64 occupied[LEVEL_NUM];
+        /// every event with deadline before current has expired.
+        u64 current;
+        std::atomic<u64> deadline;
+        std::vector<Expired> expired;
+
+        /// index of the level block tick is in, the whole range is one block above the top level.
+        static u64 get_block(u64 tick, usize level) {
+            return level * LEVEL_BITS >= 64 ? 0 : tick >> (level * LEVEL_BITS);
+        }
+
+        static usize get_slot(u64 tick, usize level) { return get_block(tick, level) % SLOT_NUM; }
+
+        static void push(TimerEvent *&head, TimerEvent &event) {
+            event.next = head;
+            event.prev = &head;
+            if (head != nullptr) head->prev = &event.next;
+            head = &event;
+        }
+
+        void link(TimerEvent &event) {
+            if (event.deadline < current) {
+                event.slot = LEVEL_NUM * SLOT_NUM;
+                push(due, event);
+                return;
+            }
+
+            usize level = 0;
+            while (get_block(event.deadline, level + 1) != get_block(current, level + 1)) ++level;
+
+            usize index = get_slot(event.deadline, level);
+            event.slot = level * SLOT_NUM + index;
+            push(slots[level][index], event);
+            occupied[level] |= static_cast<u64>(1) << index;
+        }
+
+        void unlink(TimerEvent &event) {
+            *event.prev = event.next;
+            if (event.next != nullptr) event.next->prev = event.prev;
+            event.prev = nullptr;
+            event.next = nullptr;
+
+            usize level = event.slot / SLOT_NUM, index = event.slot % SLOT_NUM;
+            if (level < LEVEL_NUM && slots[level][index] == nullptr) occupied[level] &= ~(static_cast<u64>(1) << index);
+        }
+
+        void expire_all(TimerEvent *event) {
+            while (event != nullptr) {
+                TimerEvent *next = event->next;
+                event->prev = nullptr;
+                event->next = nullptr;
+                expired.push_back(Expired{event->target, event->id, event->expire});
+                event = next;
+            }
+        }
+
+        /// detach the whole slot, returns its events.
+        TimerEvent *take(usize level, usize index) {
+            TimerEvent *head = slots[level][index];
+            slots[level][index] = nullptr;
+            occupied[level] &= ~(static_cast<u64>(1) << index);
+            return head;
+        }
+
+        /// 0 if an event is overdue, exact at level 0, the start of the first occupied slot at higher levels, and
+        /// NO_DEADLINE if there is no event.
+        u64 get_bound() const {
+            if (due != nullptr) return 0;
+
+            for (usize level = 0; level < LEVEL_NUM; ++level) {
+                // slot of current can only be occupied at level 0.
+                usize from = get_slot(current, level) + (level == 0 ? 0 : 1);
+                u64 mask = from >= SLOT_NUM ? 0 : occupied[level] >> from << from;
+                if (mask == 0) continue;
+
+                u64 base = level + 1 == LEVEL_NUM ? 0 : get_block(current, level + 1) << ((level + 1) * LEVEL_BITS);
+                return base | static_cast<u64>(__builtin_ctzll(mask)) << (level * LEVEL_BITS);
+            }
+
+            return NO_DEADLINE;
+        }
+
+        /// move current forward to tick, no event is due before it. events in the slots tick enters move down.
+        void jump(u64 tick) {
+            u64 from = current;
+            current = tick;
+
+            for (usize level = LEVEL_NUM - 1; level > 0; --level) {
+                if (get_block(tick, level) == get_block(from, level)) continue;
+
+                for (TimerEvent *event = take(level, get_slot(tick, level)); event != nullptr;) {
+                    TimerEvent *next = event->next;
+                    link(*event);
+                    event = next;
+                }
+            }
+        }
+
+        void publish() { deadline.store(get_bound(), std::memory_order_release); }
+
+    public:
+        TimerWheel() : due{nullptr}, slots{}, occupied{}, current{0}, deadline{NO_DEADLINE} {}
+
+        TimerWheel(const TimerWheel &other) = delete;
+
+        TimerWheel &operator=(const TimerWheel &other) = delete;
+
+        /// no event expires before the deadline, NO_DEADLINE if nothing is scheduled. it may be earlier than the
+        /// earliest event, advance is then called once more for nothing.
+        u64 get_deadline() const { return deadline.load(std::memory_order_acquire); }
+
+        /// a pending event is moved. an event already due expires at next advance. true if the deadline of the wheel
+        /// became earlier, the owner may be sleeping until the old one.
+        bool schedule(TimerEvent &event, u64 tick) {
+            std::lock_guard<std::mutex> guard{lock};
+
+            if (event.prev != nullptr) unlink(event);
+            event.deadline = tick;
+            link(event);
+
+            u64 old = deadline.load(std::memory_order_relaxed);
+            publish();
+            return deadline.load(std::memory_order_relaxed) < old;
+        }
+
+        /// nothing happens if event is not pending.
+        void cancel(TimerEvent &event) {
+            std::lock_guard<std::mutex> guard{lock};
+
+            if (event.prev == nullptr) return;
+            unlink(event);
+            publish();
+        }
+
+        bool is_pending(const TimerEvent &event) {
+            std::lock_guard<std::mutex> guard{lock};
+            return event.prev != nullptr;
+        }
+
+        /// expire every event due at now, overdue events first and then in order of deadline.
+        void advance(u64 now) {
+            {
+                std::lock_guard<std::mutex> guard{lock};
+
+                expire_all(due);
+                due = nullptr;
+
+                while (current <= now) {
+                    expire_all(take(0, get_slot(current, 0)));
+
+                    u64 bound = get_bound();
+                    if (current == NO_DEADLINE) break;
+                    jump(bound <= now ? bound : now + 1);
+                }
+
+                publish();
+            }
+
+            for (usize i = 0; i < expired.size(); ++i) {
+                if (expired[i].expire != nullptr) expired[i].expire(expired[i].target, expired[i].id);
+            }
+            expired.clear();
+        }
+    };
+}
+
+
+#endif //RISCV_ISA_TIMER_WHEEL_HPP
@@ -29,6 +29,11 @@ namespace riscv_isa {
             SUPERVISOR_EXTERNAL_INTERRUPT = 9,
             MACHINE_EXTERNAL_INTERRUPT = 11,
         };
+
+        /// pending and enable bits of all interrupts, in the layout of mip and mie.
+        static constexpr unsigned INTERRUPT_MASK = 0xAAAu;
+        /// supervisor level interrupts.
+        static constexpr unsigned SUPERVISOR_INTERRUPT_MASK = 0x222u;
     }
 }
 
@@ -0,0 +1,137 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "riscv_isa_utility.hpp"
+#include "device/virtio_net.hpp"
+
+#include <iostream>
+
+using namespace riscv_isa;
+
+
+/// two virtio net devices on the ends of one link, played by drivers which send batches of frames from one and
+/// hand receive buffers to the other, as two guests on one segment would. it measures the device path, a frame
+/// costs its share of one sendmmsg and one recvmmsg.
+///
+/// usage: bench_net [frame size] [batch] [milliseconds]
+
+/// one queue with a fixed buffer for each descriptor, rings at base and buffers after them.
+struct Queue {
+public:
+    static constexpr u16 NUM = 256;
+    static constexpr u64 AVAIL = 0x1000, USED = 0x2000, DATA = 0x4000, BUFFER_SIZE = 0x800;
+    static constexpr u64 SIZE = DATA + NUM * BUFFER_SIZE;
+
+    u8 *ram;
+    u64 base;
+    VirtioNet &device;
+    usize index;
+    u16 avail_idx, used_seen;
+
+    Queue(u8 *ram, u64 base, VirtioNet &device, usize index) :
+            ram{ram}, base{base}, device{device}, index{index}, avail_idx{0}, used_seen{0} {}
+
+    template<typename T>
+    T *at(u64 addr) { return reinterpret_cast<T *>(ram + addr); }
+
+    u64 get_buffer(u16 slot) const { return base + DATA + slot * BUFFER_SIZE; }
+
+    void setup() {
+        device.write(VirtioNet::QUEUE_SEL, static_cast<u32>(index));
+        device.write(VirtioNet::QUEUE_NUM, NUM);
+        device.write(VirtioNet::QUEUE_DESC_LOW, static_cast<u32>(base));
+        device.write(VirtioNet::QUEUE_DRIVER_LOW, static_cast<u32>(base + AVAIL));
+        device.write(VirtioNet::QUEUE_DEVICE_LOW, static_cast<u32>(base + USED));
+        device.write(VirtioNet::QUEUE_READY, 1);
+    }
+
+    void give(u16 slot, u32 len, bool write) {
+        u8 *desc = at<u8>(base + slot * 16u);
+        *reinterpret_cast<u64 *>(desc) = get_buffer(slot);
+        *reinterpret_cast<u32 *>(desc + 8) = len;
+        *reinterpret_cast<u16 *>(desc + 12) = write ? Virtqueue::DESC_F_WRITE : 0;
+
+        at<u16>(base + AVAIL)[2 + avail_idx % NUM] = slot;
+        ++avail_idx;
+    }
+
+    void kick() {
+        __atomic_store_n(at<u16>(base + AVAIL) + 1, avail_idx, __ATOMIC_RELEASE);
+        device.write(VirtioNet::QUEUE_NOTIFY, static_cast<u32>(index));
+    }
+
+    /// used elements since last call, their slots are free again. bytes adds up their lengths.
+    u16 take(u64 &bytes) {
+        u16 used_idx = __atomic_load_n(at<u16>(base + USED) + 1, __ATOMIC_ACQUIRE);
+        u16 num = static_cast<u16>(used_idx - used_seen);
+
+        for (; used_seen != used_idx; ++used_seen) bytes += at<u32>(base + USED + 4 + (used_seen % NUM) * 8u)[1];
+        device.write(VirtioNet::INTERRUPT_ACK, VirtioNet::INTERRUPT_USED_BUFFER);
+
+        return num;
+    }
+};
+
+int main(int argc, char **argv) {
+    usize frame_size = argc > 1 ? strtoul(argv[1], nullptr, 0) : 1500;
+    usize batch = argc > 2 ? strtoul(argv[2], nullptr, 0) : 32;
+    usize ms = argc > 3 ? strtoul(argv[3], nullptr, 0) : 1000;
+    if (frame_size == 0 || frame_size + VirtioNet::HEADER_SIZE > Queue::BUFFER_SIZE) frame_size = 1500;
+    if (batch == 0 || batch > Queue::NUM) batch = 32;
+
+    constexpr u64 MEMORY_SIZE = Queue::SIZE * 4;
+    void *memory = mmap(nullptr, MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (memory == MAP_FAILED) riscv_isa_abort("memory allocate failed");
+    u8 *ram = static_cast<u8 *>(memory);
+
+    int link[2];
+    if (!VirtioNet::make_link(link)) riscv_isa_abort("socket pair failed");
+
+    const u8 mac_a[] = {0x52, 0x54, 0x00, 0x00, 0x00, 0x01}, mac_b[] = {0x52, 0x54, 0x00, 0x00, 0x00, 0x02};
+    VirtioNet sender{GuestRAM{memory, 0, MEMORY_SIZE}, link[0], mac_a};
+    VirtioNet receiver{GuestRAM{memory, 0, MEMORY_SIZE}, link[1], mac_b};
+
+    Queue tx{ram, 0, sender, VirtioNet::TRANSMIT_QUEUE}, rx{ram, Queue::SIZE, receiver, VirtioNet::RECEIVE_QUEUE};
+    tx.setup();
+    sender.write(VirtioNet::STATUS, 0xf);
+    rx.setup();
+    receiver.write(VirtioNet::STATUS, 0xf);
+
+    for (u16 slot = 0; slot < Queue::NUM; ++slot) {
+        memset(ram + tx.get_buffer(slot), 0, VirtioNet::HEADER_SIZE);
+        memset(ram + tx.get_buffer(slot) + VirtioNet::HEADER_SIZE, slot, frame_size);
+        rx.give(slot, Queue::BUFFER_SIZE, true);
+    }
+    rx.kick();
+
+    u64 frames = 0, bytes = 0, sent_bytes = 0;
+    u16 tx_slot = 0, rx_slot = 0;
+    auto begin = std::chrono::steady_clock::now();
+    std::chrono::milliseconds duration{ms};
+
+    while (std::chrono::steady_clock::now() - begin < duration) {
+        for (usize i = 0; i < batch; ++i) tx.give(tx_slot++ % Queue::NUM, VirtioNet::HEADER_SIZE + frame_size, false);
+        tx.kick();
+        tx.take(sent_bytes);
+
+        receiver.poll();
+        u16 num = rx.take(bytes);
+        frames += num;
+        for (u16 i = 0; i < num; ++i) rx.give(rx_slot++ % Queue::NUM, Queue::BUFFER_SIZE, true);
+        rx.kick();
+    }
+
+    u64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    bytes -= frames * VirtioNet::HEADER_SIZE;
+
+    std::cout << "frame size\tbatch\tframes/s\tMB/s\tdropped" << std::endl;
+    std::cout << frame_size << '\t' << batch << '\t' << static_cast<double>(frames) * 1e9 / ns << '\t'
+              << static_cast<double>(bytes) * 1e3 / ns << '\t' << sender.get_dropped() << std::endl;
+
+    close(link[0]);
+    close(link[1]);
+    munmap(memory, MEMORY_SIZE);
+}
@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "none_hart.hpp"
+#include "target/machine.hpp"
+
+
+/// every hart spins on its own registers, harts share nothing but read only code. so throughput should grow
+/// linearly with hart count, unless state of different harts shares cache lines.
+///
+/// usage: bench_smp [max hart number] [milliseconds per run]
+
+u32 text[] = {
+        //    loop:
+        0x00130313, //        addi t1, t1, 1                  0x00
+        0xFFDFF06F, //        j loop                          0x04
+};
+
+/// harts constructed back to back in one buffer, the layout of an array of harts.
+double run_packed(NoneHart::MemT &mem, usize hart_num, usize ms) {
+    std::vector<NoneHart::IntRegT> reg(hart_num);
+    auto *harts = static_cast<NoneHart *>(malloc(sizeof(NoneHart) * hart_num));
+    if (harts == nullptr) riscv_isa_abort("hart allocate failed");
+
+    for (usize i = 0; i < hart_num; ++i) new(harts + i) NoneHart{static_cast<NoneHart::UXLenT>(i), 0, reg[i], mem};
+
+    auto begin = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (usize i = 0; i < hart_num; ++i) threads.emplace_back([harts, i]() { harts[i].start(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    for (usize i = 0; i < hart_num; ++i) harts[i].request_stop();
+    for (auto &thread: threads) thread.join();
+
+    u64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    u64 instret = 0;
+    for (usize i = 0; i < hart_num; ++i) {
+        instret += harts[i].get_instret();
+        harts[i].~NoneHart();
+    }
+    free(harts);
+
+    return static_cast<double>(instret) * 1000 / ns;
+}
+
+double run_machine(NoneHart::MemT &mem, usize hart_num, usize ms) {
+    Machine<NoneHart> machine{hart_num, 0, mem};
+
+    auto begin = std::chrono::steady_clock::now();
+
+    machine.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    machine.stop();
+    machine.join();
+
+    u64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    u64 instret = 0;
+    for (usize i = 0; i < hart_num; ++i) instret += machine.get_hart(i).get_instret();
+
+    return static_cast<double>(instret) * 1000 / ns;
+}
+
+int main(int argc, char **argv) {
+    usize max_hart_num = argc > 1 ? strtoul(argv[1], nullptr, 0) : std::thread::hardware_concurrency();
+    usize ms = argc > 2 ? strtoul(argv[2], nullptr, 0) : 1000;
+    if (max_hart_num == 0) max_hart_num = 1;
+
+    NoneHart::MemT mem{4096};
+    if (mem.address<void>(0) == nullptr) riscv_isa_abort("memory allocate failed");
+
+    mem.memory_copy(0, text, sizeof(text));
+
+    std::cout << "harts\tpacked MIPS\tmachine MIPS" << std::endl;
+    for (usize hart_num = 1; hart_num <= max_hart_num; hart_num <<= 1u) {
+        double packed = run_packed(mem, hart_num, ms);
+        double machine = run_machine(mem, hart_num, ms);
+        std::cout << hart_num << '\t' << packed << '\t' << machine << std::endl;
+    }
+}
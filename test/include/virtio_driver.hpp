@@ -0,0 +1,102 @@
+#ifndef RISCV_ISA_VIRTIO_DRIVER_HPP
+#define RISCV_ISA_VIRTIO_DRIVER_HPP
+
+
+#include "riscv_isa_utility.hpp"
+#include "test.hpp"
+#include "device/virtqueue.hpp"
+
+using namespace riscv_isa;
+
+
+/// plays the driver of any virtio device, queue i has its rings at base + i * RING_STRIDE, laid out in guest memory
+/// by hand.
+template<typename DeviceT>
+struct Driver {
+public:
+    static constexpr u64 RING_STRIDE = 0x4000, AVAIL = 0x1000, USED = 0x2000;
+    static constexpr u16 NUM = 16;
+
+    /// one buffer of a chain.
+    struct Buffer {
+        u64 addr;
+        u32 len;
+        bool write;
+    };
+
+    u8 *ram;
+    u64 base;
+    DeviceT &device;
+    u16 desc_num[2], avail_idx[2];
+
+    Driver(u8 *ram, u64 base, DeviceT &device) :
+            ram{ram}, base{base}, device{device}, desc_num{0, 0}, avail_idx{0, 0} {}
+
+    template<typename T>
+    T *at(u64 addr) { return reinterpret_cast<T *>(ram + addr); }
+
+    u64 ring(usize queue) const { return base + queue * RING_STRIDE; }
+
+    void setup(usize queue_num, u32 features) {
+        ASSERT(device.write(DeviceT::DRIVER_FEATURES, features));
+        for (usize i = 0; i < queue_num; ++i) {
+            ASSERT(device.write(DeviceT::QUEUE_SEL, i));
+            ASSERT(device.write(DeviceT::QUEUE_NUM, NUM));
+            ASSERT(device.write(DeviceT::QUEUE_DESC_LOW, ring(i)));
+            ASSERT(device.write(DeviceT::QUEUE_DRIVER_LOW, ring(i) + AVAIL));
+            ASSERT(device.write(DeviceT::QUEUE_DEVICE_LOW, ring(i) + USED));
+            ASSERT(device.write(DeviceT::QUEUE_READY, 1));
+        }
+        ASSERT(device.write(DeviceT::STATUS, 0xf));
+    }
+
+    /// chain of buffers, not yet made available.
+    void request(usize queue, const Buffer *buffers, usize num) {
+        u16 first = desc_num[queue];
+
+        for (usize i = 0; i < num; ++i) {
+            u8 *desc = at<u8>(ring(queue) + (first + i) * 16u);
+            *reinterpret_cast<u64 *>(desc) = buffers[i].addr;
+            *reinterpret_cast<u32 *>(desc + 8) = buffers[i].len;
+            *reinterpret_cast<u16 *>(desc + 12) = (i + 1 < num ? Virtqueue::DESC_F_NEXT : 0) |
+                                                  (buffers[i].write ? Virtqueue::DESC_F_WRITE : 0);
+            *reinterpret_cast<u16 *>(desc + 14) = static_cast<u16>(first + i + 1);
+        }
+        desc_num[queue] += num;
+
+        at<u16>(ring(queue) + AVAIL)[2 + avail_idx[queue] % NUM] = first;
+        ++avail_idx[queue];
+    }
+
+    /// chain of one buffer per length, laid end to end from data, not yet made available.
+    void request(usize queue, u64 data, const u32 *lengths, usize num, bool write) {
+        Buffer buffers[NUM];
+
+        for (usize i = 0; i < num; ++i) {
+            buffers[i] = Buffer{data, lengths[i], write};
+            data += lengths[i];
+        }
+
+        request(queue, buffers, num);
+    }
+
+    void notify(usize queue) {
+        at<u16>(ring(queue) + AVAIL)[1] = avail_idx[queue];
+        ASSERT(device.write(DeviceT::QUEUE_NOTIFY, queue));
+    }
+
+    void set_avail_flags(usize queue, u16 val) { at<u16>(ring(queue) + AVAIL)[0] = val; }
+
+    void set_used_event(usize queue, u16 val) { at<u16>(ring(queue) + AVAIL)[2 + NUM] = val; }
+
+    u16 get_avail_event(usize queue) { return at<u16>(ring(queue) + USED)[2 + NUM * 4]; }
+
+    u16 get_used_idx(usize queue) { return at<u16>(ring(queue) + USED)[1]; }
+
+    u32 get_used_len(usize queue, u16 index) { return at<u32>(ring(queue) + USED + 4 + index * 8u)[1]; }
+
+    void ack() { ASSERT(device.write(DeviceT::INTERRUPT_ACK, DeviceT::INTERRUPT_USED_BUFFER)); }
+};
+
+
+#endif //RISCV_ISA_VIRTIO_DRIVER_HPP
@@ -0,0 +1,48 @@
+#include "test.hpp"
+#include "none_hart.hpp"
+
+
+int main() {
+    u32 text[] = {
+            //    main:
+            0x20000293, //        addi t0, x0, 0x200            0x00
+            0xFFF00313, //        addi t1, x0, -1               0x04
+            0x0862B02F, //        amoswap.d x0, t1, (t0)        0x08
+            0x00500393, //        addi t2, x0, 5                0x0c
+            0x0072B5AF, //        amoadd.d a1, t2, (t0)         0x10
+            0xA062B62F, //        amomax.d a2, t1, (t0)         0x14
+            0xC062B6AF, //        amominu.d a3, t1, (t0)        0x18
+            0xE062B72F, //        amomaxu.d a4, t1, (t0)        0x1c
+            0x1002A92F, //        lr.w s2, (t0)                 0x20
+            0x1002B7AF, //        lr.d a5, (t0)                 0x24
+            0x00278793, //        addi a5, a5, 2                0x28
+            0x18F2B82F, //        sc.d a6, a5, (t0)             0x2c
+            0x18F2B8AF, //        sc.d a7, a5, (t0)             0x30
+            0x8062B9AF, //        amomin.d s3, t1, (t0)         0x34
+            0x0002BA03, //        ld s4, 0(t0)                  0x38
+            0x00A00513, //        addi a0, x0, 10               0x3c
+            0x00000073, //        ecall # Exit                  0x40
+    };
+
+    NoneHart::IntRegT reg{};
+
+    NoneHart::MemT mem{4096};
+    if (mem.address<void>(0) == nullptr) riscv_isa_abort("memory allocate failed");
+
+    mem.memory_copy(0, text, sizeof(text));
+
+    NoneHart core{0, 0, reg, mem};
+    core.start();
+
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A1), -1);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A2), 4);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A3), 4);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A4), 4);
+    // lr.w sign extends.
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::S2), -1);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A6), 0);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A7), 1);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::S3), 1);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::S4), -1);
+    ASSERT_EQ(*mem.address<u64>(0x200), ~0ull);
+}
@@ -0,0 +1,65 @@
+#include "test.hpp"
+#include "none_hart.hpp"
+
+
+int main() {
+    u32 text[] = {
+            //    main:
+            0xC02022F3, //        rdinstret t0                  0x00
+            0x06400313, //        addi t1, x0, 100              0x04
+            //    loop:
+            0xFFF30313, //        addi t1, t1, -1               0x08
+            0xFE031EE3, //        bne t1, x0, loop              0x0c
+            0xC02023F3, //        rdinstret t2                  0x10
+            0xC0002E73, //        rdcycle t3                    0x14
+            0xC0102EF3, //        rdtime t4                     0x18
+            0xC0102F73, //        rdtime t5                     0x1c
+            0x00002683, //        lw a3, 0(x0)                  0x20
+            0x00402683, //        lw a3, 4(x0)                  0x24
+            0xC03025F3, //        rdhpmcounter3 a1              0x28
+            0xC0402673, //        rdhpmcounter4 a2              0x2c
+            0x00A00513, //        addi a0, x0, 10               0x30
+            0x00000073, //        ecall # Exit                  0x34
+    };
+
+    u32 trap_text[] = {
+            //    trap:
+            0x00B00513, //        addi a0, x0, 11               0x100
+            0x02000593, //        addi a1, x0, 0x20             0x104
+            0xC02022F3, //        rdinstret t0                  0x108
+            0x00000073, //        ecall # Print ' '             0x10c
+            0xC0202373, //        rdinstret t1                  0x110
+            0x00A00513, //        addi a0, x0, 10               0x114
+            0x00000073, //        ecall # Exit                  0x118
+    };
+
+    NoneHart::IntRegT reg{};
+
+    NoneHart::MemT mem{4096};
+    if (mem.address<void>(0) == nullptr) riscv_isa_abort("memory allocate failed");
+
+    mem.memory_copy(0, text, sizeof(text));
+    mem.memory_copy(0x100, trap_text, sizeof(trap_text));
+
+    NoneHart core{0, 0, reg, mem};
+    core.set_mhpmevent3_csr_reg(HPM_EVENT_BRANCH_TAKEN);
+    core.set_mhpmevent4_csr_reg(HPM_EVENT_LOAD);
+
+    // small blocks, counters need to be continuous across block boundaries.
+    while (core.run(7)) {}
+
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::T2) - core.get_x(NoneHart::IntRegT::T0), 202);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::T3), core.get_x(NoneHart::IntRegT::T2) + 1);
+    ASSERT(static_cast<u32>(core.get_x(NoneHart::IntRegT::T5) - core.get_x(NoneHart::IntRegT::T4)) < 0x80000000u);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A1), 99);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A2), 2);
+    ASSERT_EQ(core.get_instret(), 211u);
+
+    // an ecall traps, so it is not retired even though its handler resumes execution.
+    NoneHart::IntRegT trap_reg{};
+    NoneHart trap_core{0, 0x100, trap_reg, mem};
+    while (trap_core.run(7)) {}
+
+    ASSERT_EQ(trap_core.get_x(NoneHart::IntRegT::T1) - trap_core.get_x(NoneHart::IntRegT::T0), 1);
+    ASSERT_EQ(trap_core.get_instret(), 5u);
+}
@@ -0,0 +1,130 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "test.hpp"
+#include "none_hart.hpp"
+#include "target/machine.hpp"
+#include "device/clint.hpp"
+#include "device/plic.hpp"
+
+
+u32 get_u32(const u8 *bytes) {
+    return static_cast<u32>(bytes[0]) << 24u | static_cast<u32>(bytes[1]) << 16u |
+           static_cast<u32>(bytes[2]) << 8u | bytes[3];
+}
+
+/// value of property at path, e.g. "/cpus/cpu@0/reg", by walking the structure block. false if there is none.
+bool find_property(const std::vector<u8> &blob, const std::string &path, std::vector<u8> &val) {
+    const u8 *structure = blob.data() + get_u32(blob.data() + 0x08);
+    const char *strings = reinterpret_cast<const char *>(blob.data() + get_u32(blob.data() + 0x0c));
+    std::string current{};
+
+    for (usize offset = 0;;) {
+        u32 token = get_u32(structure + offset);
+        offset += 4;
+
+        if (token == FDTWriter::BEGIN_NODE) {
+            const char *name = reinterpret_cast<const char *>(structure + offset);
+            if (*name != '\0') current += "/" + std::string{name};
+            offset += (strlen(name) + 4) / 4 * 4;
+        } else if (token == FDTWriter::END_NODE) {
+            current.erase(current.empty() ? 0 : current.rfind('/'));
+        } else if (token == FDTWriter::PROP) {
+            u32 length = get_u32(structure + offset);
+            const char *name = strings + get_u32(structure + offset + 4);
+            offset += 8;
+            if (current + "/" + name == path) {
+                val.assign(structure + offset, structure + offset + length);
+                return true;
+            }
+            offset += (length + 3) / 4 * 4;
+        } else {
+            return false;
+        }
+    }
+}
+
+std::string find_string(const std::vector<u8> &blob, const std::string &path) {
+    std::vector<u8> val;
+    return find_property(blob, path, val) && !val.empty() ? std::string{reinterpret_cast<char *>(val.data())} : "";
+}
+
+std::vector<u32> find_cells(const std::vector<u8> &blob, const std::string &path) {
+    std::vector<u8> val;
+    std::vector<u32> cells;
+    if (find_property(blob, path, val))
+        for (usize i = 0; i + 4 <= val.size(); i += 4) cells.push_back(get_u32(val.data() + i));
+
+    return cells;
+}
+
+int main() {
+    u32 text[] = {
+            //    main:
+            0x0005A603, //        lw a2, 0(a1)                  0x00
+            0x00050693, //        mv a3, a0                     0x04
+            0x00A00513, //        addi a0, x0, 10               0x08
+            0x00000073, //        ecall # Exit                  0x0c
+    };
+
+    constexpr u64 DTB_ADDR = 0x1000;
+    NoneHart::MemT mem{0x4000};
+    if (mem.address<void>(0) == nullptr) riscv_isa_abort("memory allocate failed");
+
+    mem.memory_copy(0, text, sizeof(text));
+
+    Machine<NoneHart> machine{2, 0, mem};
+
+    DeviceTree tree = machine.get_device_tree();
+    ASSERT_EQ(tree.get_hart_num(), 2u);
+    ASSERT_EQ(tree.get_isa(), "rv32ima_zicsr_zifencei");
+    ASSERT_EQ(DeviceTree::get_isa_string<u64>(2ull << 62u | 1u << 8u | 1u << 12u | 1u << 2u), "rv64imc_zicsr_zifencei");
+
+    tree.add_memory(0x80000000, 0x8000000);
+    tree.add_clint(0x2000000, CLINT<NoneHart>::SIZE);
+    tree.add_plic(0xc000000, PLIC<NoneHart>::SIZE, PLIC<NoneHart>::SOURCE_NUM - 1);
+    tree.add_uart(0x10000000, 0x100, 10);
+    tree.add_virtio(0x10001000, 0x1000, 1);
+    tree.set_bootargs("console=ttyS0");
+    std::vector<u8> dtb = tree.build();
+
+    // header, the blocks follow each other in the order dtc puts them.
+    ASSERT_EQ(get_u32(dtb.data()), FDTWriter::MAGIC);
+    ASSERT_EQ(get_u32(dtb.data() + 0x04), dtb.size());
+    ASSERT_EQ(get_u32(dtb.data() + 0x10), FDTWriter::HEADER_SIZE);
+    ASSERT_EQ(get_u32(dtb.data() + 0x14), FDTWriter::VERSION);
+    ASSERT_EQ(get_u32(dtb.data() + 0x08) + get_u32(dtb.data() + 0x24), get_u32(dtb.data() + 0x0c));
+    ASSERT_EQ(get_u32(dtb.data() + 0x0c) + get_u32(dtb.data() + 0x20), dtb.size());
+
+    ASSERT_EQ(find_string(dtb, "/cpus/cpu@1/riscv,isa"), "rv32ima_zicsr_zifencei");
+    ASSERT_EQ(find_string(dtb, "/cpus/cpu@1/interrupt-controller/compatible"), "riscv,cpu-intc");
+    ASSERT(find_cells(dtb, "/cpus/timebase-frequency") == std::vector<u32>{RISCV_TIME_FREQUENCY});
+    ASSERT(find_cells(dtb, "/memory@80000000/reg") == (std::vector<u32>{0, 0x80000000, 0, 0x8000000}));
+    ASSERT_EQ(find_string(dtb, "/chosen/bootargs"), "console=ttyS0");
+    ASSERT_EQ(find_string(dtb, "/chosen/stdout-path"), "/soc/serial@10000000");
+
+    // clint and plic reach every hart through its cpu interrupt controller, devices are plic sources.
+    ASSERT(find_cells(dtb, "/soc/clint@2000000/interrupts-extended") ==
+           (std::vector<u32>{1, 3, 1, 7, 2, 3, 2, 7}));
+    ASSERT(find_cells(dtb, "/soc/plic@c000000/interrupts-extended") ==
+           (std::vector<u32>{1, 11, 1, 9, 2, 11, 2, 9}));
+    ASSERT(find_cells(dtb, "/soc/plic@c000000/phandle") == std::vector<u32>{3});
+    ASSERT(find_cells(dtb, "/soc/serial@10000000/interrupt-parent") == std::vector<u32>{3});
+    ASSERT(find_cells(dtb, "/soc/virtio_mmio@10001000/interrupts") == std::vector<u32>{1});
+    ASSERT_EQ(find_string(dtb, "/soc/virtio_mmio@10001000/compatible"), "virtio,mmio");
+
+    std::vector<u8> val;
+    ASSERT(!find_property(dtb, "/soc/virtio_mmio@10001000/clock-frequency", val));
+
+    // every hart boots with its id in a0 and the dtb in a1.
+    ASSERT(!machine.load_device_tree(mem, 0x3f00, dtb));
+    ASSERT(machine.load_device_tree(mem, DTB_ADDR, dtb));
+    machine.run_deterministic();
+
+    for (usize i = 0; i < machine.get_hart_num(); ++i) {
+        ASSERT_EQ(static_cast<u64>(machine.get_hart(i).get_x(NoneHart::IntRegT::A1)), DTB_ADDR);
+        ASSERT_EQ(static_cast<u32>(machine.get_hart(i).get_x(NoneHart::IntRegT::A2)), 0xedfe0dd0u);
+        ASSERT_EQ(static_cast<usize>(machine.get_hart(i).get_x(NoneHart::IntRegT::A3)), i);
+    }
+}
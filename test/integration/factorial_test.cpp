@@ -1,118 +1,5 @@
-#include <cstring>
-#include <sys/mman.h>
+#include "none_hart.hpp"
 
-#include "target/hart.hpp"
-#include "target/dump.hpp"
-
-using namespace riscv_isa;
-
-
-template<typename xlen>
-class Memory {
-private:
-    using XLenT = typename xlen::UXLenT;
-
-    u8 *memory_offset;
-    usize memory_size;
-
-public:
-
-    Memory(usize _memory_size) : memory_size{_memory_size} {
-        memory_offset = static_cast<u8 *>(mmap(nullptr, memory_size, PROT_READ | PROT_WRITE,
-                                               MAP_ANONYMOUS | MAP_SHARED, -1, 0));
-        if (memory_offset == MAP_FAILED) {
-            memory_offset = nullptr;
-            memory_size = 0;
-        }
-    }
-
-    Memory(const Memory &other) = delete;
-
-    Memory &operator=(const Memory &other) = delete;
-
-    template<typename T>
-    T *address(XLenT addr) {
-        return addr < memory_size ? reinterpret_cast<T *>(memory_offset + addr) : nullptr;
-    }
-
-    bool memory_copy(XLenT offset, const void *src, usize length) {
-        if (offset <= memory_size - length) {
-            memcpy(memory_offset + offset, src, length);
-            return true;
-        } else {
-            return false;
-        }
-    }
-
-    ~Memory() { if (memory_offset != nullptr) munmap(memory_offset, memory_size); }
-};
-
-
-class NoneHart : public Hart<NoneHart, xlen_trait> {
-public:
-    using MemT = Memory<xlen_trait>;
-
-protected:
-    MemT &mem;
-
-public:
-    NoneHart(UXLenT hart_id, XLenT pc, IntRegT &reg, MemT &mem) : Hart{hart_id, pc, reg}, mem{mem} {
-        cur_level = PrivilegeLevel::USER_MODE;
-    }
-
-    template<typename ValT>
-    const ValT *address_load(UXLenT addr) { return mem.template address<ValT>(addr); }
-
-    template<typename ValT>
-    ValT *address_store(UXLenT addr) { return mem.template address<ValT>(addr); }
-
-    template<typename ValT>
-    const ValT *address_execute(UXLenT addr) { return mem.template address<ValT>(addr); }
-
-#if defined(__RV_EXTENSION_ZICSR__)
-
-    UXLenT get_csr_reg(UXLenT index) { return csr_reg[index]; }
-
-    RetT set_csr_reg(riscv_isa_unused UXLenT index, riscv_isa_unused UXLenT val) { return true; }
-
-#endif // defined(__RV_EXTENSION_ZICSR__)
-
-    RetT visit_fence_inst(riscv_isa_unused const FENCEInst *inst) {
-        inc_pc(FENCEInst::INST_WIDTH);
-        return true;
-    }
-
-    RetT visit_inst(const riscv_isa::Instruction *inst) { return illegal_instruction(inst); }
-
-    bool u_mode_environment_call_handler() {
-        bool ret = false;
-
-        switch (get_x(IntRegT::A0)) {
-            case 1:
-                std::cout << std::dec << get_x(IntRegT::A1);
-                ret = true;
-                break;
-            case 11:
-                std::cout << static_cast<char>(get_x(IntRegT::A1));
-                ret = true;
-                break;
-            case 10:
-                std::cout << std::endl << "[exit]" << std::endl;
-                ret = false;
-                break;
-            default:
-                std::cerr << "Invalid enviroment call number at " << std::hex << get_pc()
-                          << ", call number " << std::dec << get_x(IntRegT::A7)
-                          << std::endl;
-                ret = false;
-                break;
-        }
-
-        this->inc_pc(riscv_isa::ECALLInst::INST_WIDTH);
-
-        return ret;
-    }
-};
 
 int main() {
     u32 text[] = {
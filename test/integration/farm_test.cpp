@@ -0,0 +1,70 @@
+#include <memory>
+#include <vector>
+
+#include "test.hpp"
+#include "none_hart.hpp"
+#include "target/farm.hpp"
+
+
+struct Job {
+public:
+    NoneHart::IntRegT reg;
+    NoneHart::MemT mem;
+    NoneHart hart;
+
+    Job(const u32 *text, usize length, u32 n) : reg{}, mem{4096}, hart{0, 0, reg, mem} {
+        if (mem.address<void>(0) == nullptr) riscv_isa_abort("memory allocate failed");
+
+        mem.memory_copy(0, text, length);
+        hart.set_x(NoneHart::IntRegT::A1, n);
+    }
+
+    bool run(usize budget) { return hart.run(budget); }
+
+    u64 get_instret() const { return hart.get_instret(); }
+};
+
+
+int main() {
+    u32 text[] = {
+            //    loop:
+            0x00B60633, //        add a2, a2, a1                0x00
+            0xFFF58593, //        addi a1, a1, -1               0x04
+            0xFE059CE3, //        bne a1, x0, loop              0x08
+            0x00A00513, //        addi a0, x0, 10               0x0c
+            0x00000073, //        ecall # Exit                  0x10
+    };
+
+    constexpr usize JOB_NUM = 64;
+
+    std::vector<std::unique_ptr<Job>> jobs;
+    u64 instret = 0;
+
+    // job lengths differ by a factor of 64, small quantum makes every long job sliced many times.
+    Farm<Job> farm{4, 256};
+    for (usize i = 0; i < JOB_NUM; ++i) {
+        u32 n = (i + 1) * 100;
+        jobs.emplace_back(new Job{text, sizeof(text), n});
+        farm.submit(*jobs.back());
+        instret += 3 * n + 1;
+    }
+
+    farm.run();
+
+    for (usize i = 0; i < JOB_NUM; ++i) {
+        u32 n = (i + 1) * 100;
+        ASSERT_EQ(static_cast<u32>(jobs[i]->hart.get_x(NoneHart::IntRegT::A2)), n * (n + 1) / 2);
+    }
+
+    ASSERT_EQ(farm.get_instret(), instret);
+    ASSERT(farm.get_mips() > 0);
+
+    // more workers than jobs, idle workers sleep until the last job ends.
+    Job single{text, sizeof(text), 20000};
+    Farm<Job> sparse{4, 256};
+    sparse.submit(single);
+    sparse.run();
+
+    ASSERT_EQ(static_cast<u32>(single.hart.get_x(NoneHart::IntRegT::A2)), 20000u * 20001u / 2);
+    ASSERT_EQ(sparse.get_instret(), 3u * 20000u + 1);
+}
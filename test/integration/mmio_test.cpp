@@ -0,0 +1,70 @@
+#include "test.hpp"
+#include "none_hart.hpp"
+
+
+/// one word register counting its accesses.
+struct Scratch {
+public:
+    u32 reg;
+    usize access_num;
+
+    bool read(usize offset, u32 &val) {
+        if (offset != 0) return false;
+
+        ++access_num;
+        val = reg;
+        return true;
+    }
+
+    bool write(usize offset, u32 val) {
+        if (offset != 0) return false;
+
+        ++access_num;
+        reg = val;
+        return true;
+    }
+};
+
+int main() {
+    u32 text[] = {
+            //    main:
+            0x100002B7, //        lui t0, 0x10000 # device        0x00
+            0x00500313, //        addi t1, x0, 5                  0x04
+            0x0062A023, //        sw t1, 0(t0)                    0x08
+            0x00300393, //        addi t2, x0, 3                  0x0c
+            0x0072A5AF, //        amoadd.w a1, t2, (t0)           0x10
+            0x0002A603, //        lw a2, 0(t0)                    0x14
+            0x10000E13, //        addi t3, x0, 0x100              0x18
+            0x00700E93, //        addi t4, x0, 7                  0x1c
+            0x09DE26AF, //        amoswap.w a3, t4, (t3)          0x20
+            0xE1D2A72F, //        amomaxu.w a4, t4, (t0)          0x24
+            0x000E2783, //        lw a5, 0(t3)                    0x28
+            0x00A00513, //        addi a0, x0, 10                 0x2c
+            0x00000073, //        ecall # Exit                    0x30
+    };
+
+    NoneHart::IntRegT reg{};
+
+    NoneHart::MemT mem{4096};
+    if (mem.address<void>(0) == nullptr) riscv_isa_abort("memory allocate failed");
+
+    mem.memory_copy(0, text, sizeof(text));
+
+    Scratch scratch{0, 0};
+    MMIOBus bus{};
+    ASSERT(bus.map(0x10000000, 0x1000, scratch));
+    ASSERT(!bus.map(0x10000800, 0x1000, scratch));
+
+    NoneHart core{0, 0, reg, mem};
+    core.bus = &bus;
+    core.start();
+
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A1), 5);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A2), 8);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A3), 0);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A4), 8);
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A5), 7);
+    ASSERT_EQ(scratch.reg, 8u);
+    // sw and lw access once, every amo loads and stores.
+    ASSERT_EQ(scratch.access_num, 6u);
+}
@@ -0,0 +1,165 @@
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "test.hpp"
+#include "none_hart.hpp"
+#include "target/machine.hpp"
+#include "device/plic.hpp"
+#include "device/uart.hpp"
+
+
+int main() {
+    u32 text[] = {
+            //    idle:
+            0x10500073, //        wfi                           0x00
+            0xFFDFF06F, //        j idle                        0x04
+    };
+
+    NoneHart::MemT mem{4096};
+    if (mem.address<void>(0) == nullptr) riscv_isa_abort("memory allocate failed");
+
+    mem.memory_copy(0, text, sizeof(text));
+
+    constexpr u32 MEIP = 1u << trap::MACHINE_EXTERNAL_INTERRUPT;
+    constexpr u32 SEIP = 1u << trap::SUPERVISOR_EXTERNAL_INTERRUPT;
+    using PLICT = PLIC<NoneHart>;
+
+    Machine<NoneHart> machine{2, 0, mem};
+    PLICT plic{};
+    for (usize i = 0; i < machine.get_hart_num(); ++i) plic.attach(machine.get_hart(i));
+    NoneHart &hart0 = machine.get_hart(0), &hart1 = machine.get_hart(1);
+
+    u32 val = 0;
+    ASSERT(plic.write(PLICT::PRIORITY_BASE + 4 * 3, 2));
+    ASSERT(plic.write(PLICT::PRIORITY_BASE + 4 * 5, 1));
+    ASSERT(plic.write(PLICT::PRIORITY_BASE + 4 * 40, 3));
+    ASSERT(plic.write(PLICT::ENABLE_BASE, (1u << 3) | (1u << 5)));
+    ASSERT(plic.write(PLICT::ENABLE_BASE + PLICT::ENABLE_STRIDE * 3 + 4, 1u << 8));
+    ASSERT(!plic.write(PLICT::ENABLE_BASE + PLICT::ENABLE_STRIDE * 4, 1));
+
+    // source 5 and 3 pending, claims go in priority order, a line still high comes back on complete.
+    plic.set_irq(5, true);
+    ASSERT_EQ(hart0.get_interrupt_pending(), MEIP);
+    plic.set_irq(3, true);
+    ASSERT(plic.read(PLICT::PENDING_BASE, val) && val == ((1u << 3) | (1u << 5)));
+    ASSERT(plic.read(PLICT::CONTEXT_BASE + 4, val) && val == 3);
+    ASSERT(plic.read(PLICT::CONTEXT_BASE + 4, val) && val == 5);
+    ASSERT_EQ(hart0.get_interrupt_pending(), 0u);
+    ASSERT(plic.read(PLICT::CONTEXT_BASE + 4, val) && val == 0);
+
+    plic.set_irq(5, false);
+    ASSERT(plic.write(PLICT::CONTEXT_BASE + 4, 5));
+    ASSERT(plic.write(PLICT::CONTEXT_BASE + 4, 3));
+    ASSERT_EQ(hart0.get_interrupt_pending(), MEIP);
+    ASSERT(plic.read(PLICT::PENDING_BASE, val) && val == 1u << 3);
+
+    // threshold masks the notification, not the claim.
+    ASSERT(plic.write(PLICT::CONTEXT_BASE, 2));
+    ASSERT_EQ(hart0.get_interrupt_pending(), 0u);
+    ASSERT(plic.write(PLICT::CONTEXT_BASE, 1));
+    ASSERT_EQ(hart0.get_interrupt_pending(), MEIP);
+    plic.set_irq(3, false);
+    ASSERT_EQ(hart0.get_interrupt_pending(), 0u);
+
+    // supervisor context of hart 1 drives seip only.
+    plic.set_irq(40, true);
+    ASSERT_EQ(hart1.get_interrupt_pending(), SEIP);
+    ASSERT(plic.read(PLICT::CONTEXT_BASE + PLICT::CONTEXT_STRIDE * 3 + 4, val) && val == 40);
+    ASSERT_EQ(hart1.get_interrupt_pending(), 0u);
+    plic.set_irq(40, false);
+    ASSERT(plic.write(PLICT::CONTEXT_BASE + PLICT::CONTEXT_STRIDE * 3 + 4, 40));
+
+    // sources toggled by many threads at once settle on their final level.
+    std::vector<std::thread> threads;
+    ASSERT(plic.write(PLICT::ENABLE_BASE + PLICT::ENABLE_STRIDE * 3, 0xfu << 8));
+    for (usize i = 0; i < 4; ++i) {
+        ASSERT(plic.write(PLICT::PRIORITY_BASE + 4 * (8 + i), 1));
+        threads.emplace_back([&plic, i]() {
+            for (usize j = 0; j < 10000; ++j) plic.set_irq(8 + i, j % 2 == 0);
+        });
+    }
+    for (auto &thread: threads) thread.join();
+    ASSERT_EQ(hart1.get_interrupt_pending(), 0u);
+    for (usize i = 0; i < 4; ++i) plic.set_irq(8 + i, i % 2 == 0);
+    ASSERT_EQ(hart1.get_interrupt_pending(), SEIP);
+    ASSERT(plic.read(PLICT::CONTEXT_BASE + PLICT::CONTEXT_STRIDE * 3 + 4, val) && val == 8);
+    ASSERT(plic.read(PLICT::CONTEXT_BASE + PLICT::CONTEXT_STRIDE * 3 + 4, val) && val == 10);
+    ASSERT(plic.read(PLICT::CONTEXT_BASE + PLICT::CONTEXT_STRIDE * 3 + 4, val) && val == 0);
+    ASSERT_EQ(hart1.get_interrupt_pending(), 0u);
+
+    // uart interrupt wakes both harts from wfi, which end in the default interrupt handler without stop.
+    int out[2];
+    ASSERT(pipe(out) == 0);
+
+    UART uart{-1, out[1]};
+    uart.get_irq_line().connect(plic, 20);
+    ASSERT(plic.write(PLICT::PRIORITY_BASE + 4 * 20, 1));
+    ASSERT(plic.write(PLICT::CONTEXT_BASE, 0));
+    ASSERT(plic.write(PLICT::ENABLE_BASE, 1u << 20));
+    ASSERT(plic.write(PLICT::ENABLE_BASE + PLICT::ENABLE_STRIDE * 2, 1u << 20));
+    hart0.set_mie_csr_reg(MEIP);
+    hart1.set_mie_csr_reg(MEIP);
+
+    machine.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    ASSERT(uart.write(UART::IER_DLM, UART::IER_THRI));
+    machine.join();
+
+    ASSERT_EQ(hart0.get_interrupt_pending(), MEIP);
+    ASSERT(plic.read(PLICT::CONTEXT_BASE + 4, val) && val == 20);
+
+    // delegated interrupts trap to supervisor mode, machine mode never takes them and supervisor mode only with SIE.
+    // the others are taken below machine mode whatever mstatus is.
+    constexpr u32 MSIP = 1u << trap::MACHINE_SOFTWARE_INTERRUPT, SSIP = 1u << trap::SUPERVISOR_SOFTWARE_INTERRUPT;
+    NoneHart::IntRegT reg{};
+    NoneHart hart{0, 0, reg, mem};
+    hart.set_mie_csr_reg(MSIP | SSIP);
+    hart.set_csr_reg(NoneHart::CSRRegT::MIDELEG, SSIP);
+
+    hart.set_privilege_level(PrivilegeLevel::MACHINE_MODE);
+    hart.set_csr_reg(NoneHart::CSRRegT::MSTATUS, NoneHart::MSTATUS_MIE | NoneHart::MSTATUS_SIE);
+    ASSERT_EQ(hart.get_interrupt_enabled(MSIP | SSIP), MSIP);
+    hart.set_csr_reg(NoneHart::CSRRegT::MSTATUS, 0);
+    ASSERT_EQ(hart.get_interrupt_enabled(MSIP | SSIP), 0u);
+
+    hart.set_privilege_level(PrivilegeLevel::SUPERVISOR_MODE);
+    ASSERT_EQ(hart.get_interrupt_enabled(MSIP | SSIP), MSIP);
+    hart.set_csr_reg(NoneHart::CSRRegT::MSTATUS, NoneHart::MSTATUS_SIE);
+    ASSERT_EQ(hart.get_interrupt_enabled(MSIP | SSIP), MSIP | SSIP);
+
+    hart.set_privilege_level(PrivilegeLevel::USER_MODE);
+    hart.set_csr_reg(NoneHart::CSRRegT::MSTATUS, 0);
+    ASSERT_EQ(hart.get_interrupt_enabled(MSIP | SSIP), MSIP | SSIP);
+
+    // a pending delegated interrupt waits in supervisor mode until SIE is set, then ends in its default handler.
+    // only the interrupt taken is counted as trap.
+    hart.set_mhpmevent3_csr_reg(HPM_EVENT_TRAP);
+    hart.set_privilege_level(PrivilegeLevel::SUPERVISOR_MODE);
+    hart.raise_interrupt(trap::SUPERVISOR_SOFTWARE_INTERRUPT);
+    ASSERT(hart.handle_attention());
+    ASSERT_EQ(hart.get_mhpmcounter3_csr_reg(), 0u);
+    hart.set_csr_reg(NoneHart::CSRRegT::MSTATUS, NoneHart::MSTATUS_SIE);
+    ASSERT(!hart.handle_attention());
+    ASSERT_EQ(hart.get_mhpmcounter3_csr_reg(), 1u);
+
+    // a pending interrupt masked by mstatus leaves blocks running to their budget, unmasking it ends the next one
+    // at the first backward jump.
+    u32 spin_text[] = {
+            //    spin:
+            0x00130313, //        addi t1, t1, 1                0x100
+            0xFFDFF06F, //        j spin                        0x104
+    };
+    mem.memory_copy(0x100, spin_text, sizeof(spin_text));
+
+    NoneHart::IntRegT spin_reg{};
+    NoneHart spin{0, 0x100, spin_reg, mem};
+    spin.set_privilege_level(PrivilegeLevel::MACHINE_MODE);
+    spin.set_mie_csr_reg(MSIP);
+    spin.raise_interrupt(trap::MACHINE_SOFTWARE_INTERRUPT);
+    ASSERT(spin.run(1000));
+    ASSERT_EQ(spin.get_instret(), 1000u);
+    spin.set_mstatus_csr_reg(NoneHart::MSTATUS_MIE);
+    ASSERT(!spin.run(1000));
+    ASSERT_EQ(spin.get_instret(), 1002u);
+}
@@ -0,0 +1,143 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "test.hpp"
+#include "none_hart.hpp"
+#include "target/machine.hpp"
+
+
+int main() {
+    u32 text[] = {
+            //    main:
+            0x00100513, //        addi a0, x0, 1 # SYS_OPEN     0x00
+            0x40000593, //        addi a1, x0, 0x400            0x04
+            0x01F01013, //        slli x0, x0, 0x1f             0x08
+            0x00100073, //        ebreak                        0x0c
+            0x40705013, //        srai x0, x0, 7                0x10
+            0x40A02823, //        sw a0, 0x410(x0)              0x14
+            0x00500513, //        addi a0, x0, 5 # SYS_WRITE    0x18
+            0x41000593, //        addi a1, x0, 0x410            0x1c
+            0x01F01013, //        slli x0, x0, 0x1f             0x20
+            0x00100073, //        ebreak                        0x24
+            0x40705013, //        srai x0, x0, 7                0x28
+            0x48A02023, //        sw a0, 0x480(x0)              0x2c
+            0x00100513, //        addi a0, x0, 1 # SYS_OPEN     0x30
+            0x42000593, //        addi a1, x0, 0x420            0x34
+            0x01F01013, //        slli x0, x0, 0x1f             0x38
+            0x00100073, //        ebreak                        0x3c
+            0x40705013, //        srai x0, x0, 7                0x40
+            0x42A02823, //        sw a0, 0x430(x0)              0x44
+            0x00600513, //        addi a0, x0, 6 # SYS_READ     0x48
+            0x43000593, //        addi a1, x0, 0x430            0x4c
+            0x01F01013, //        slli x0, x0, 0x1f             0x50
+            0x00100073, //        ebreak                        0x54
+            0x40705013, //        srai x0, x0, 7                0x58
+            0x48A02223, //        sw a0, 0x484(x0)              0x5c
+            0x01300513, //        addi a0, x0, 0x13 # SYS_ERRNO 0x60
+            0x01F01013, //        slli x0, x0, 0x1f             0x64
+            0x00100073, //        ebreak                        0x68
+            0x40705013, //        srai x0, x0, 7                0x6c
+            0x48A02423, //        sw a0, 0x488(x0)              0x70
+            0x00100073, //        ebreak # breakpoint           0x74
+            0x02000513, //        addi a0, x0, 0x20 # EXIT_EXT  0x78
+            0x44000593, //        addi a1, x0, 0x440            0x7c
+            0x01F01013, //        slli x0, x0, 0x1f             0x80
+            0x00100073, //        ebreak                        0x84
+            0x40705013, //        srai x0, x0, 7                0x88
+            //    spin:
+            0x0000006F, //        j spin                        0x8c
+    };
+
+    u32 exit_text[] = {
+            //    exit:
+            0x00061E63, //        bnez a2, spin                 0x100
+            0x01800513, //        addi a0, x0, 0x18 # SYS_EXIT  0x104
+            0x000205B7, //        lui a1, 0x20                  0x108
+            0x02658593, //        addi a1, a1, 0x26             0x10c
+            0x01F01013, //        slli x0, x0, 0x1f             0x110
+            0x00100073, //        ebreak                        0x114
+            0x40705013, //        srai x0, x0, 7                0x118
+            //    spin:
+            0x0000006F, //        j spin                        0x11c
+    };
+
+    NoneHart::IntRegT reg{};
+
+    NoneHart::MemT mem{4096};
+    if (mem.address<void>(0) == nullptr) riscv_isa_abort("memory allocate failed");
+
+    mem.memory_copy(0, text, sizeof(text));
+    mem.memory_copy(0x100, exit_text, sizeof(exit_text));
+
+    char path[] = "/tmp/riscv_isa_semihosting_XXXXXX";
+    int file = mkstemp(path);
+    ASSERT(file >= 0);
+    ASSERT_EQ(write(file, "input", 5), 5);
+    close(file);
+
+    // parameter blocks, handles are filled in by the guest.
+    u32 console_open[] = {0x500, 4, 3}, console_write[] = {0, 0x520, 6};
+    u32 file_open[] = {0x540, 0, static_cast<u32>(strlen(path))}, file_read[] = {0, 0x600, 16};
+    u32 exit_code[] = {static_cast<u32>(Semihosting::ADP_STOPPED_APPLICATION_EXIT), 3};
+    mem.memory_copy(0x400, console_open, sizeof(console_open));
+    mem.memory_copy(0x410, console_write, sizeof(console_write));
+    mem.memory_copy(0x420, file_open, sizeof(file_open));
+    mem.memory_copy(0x430, file_read, sizeof(file_read));
+    mem.memory_copy(0x440, exit_code, sizeof(exit_code));
+    mem.memory_copy(0x500, ":tt", 3);
+    mem.memory_copy(0x520, "hello\n", 6);
+    mem.memory_copy(0x540, path, strlen(path));
+
+    int out[2];
+    ASSERT(pipe(out) == 0);
+    Semihosting host{-1, out[1], out[1]};
+
+    NoneHart core{0, 0, reg, mem};
+    core.set_semihosting(&host);
+    core.start();
+
+    // the hart stops right after the exit call, a bare ebreak is still a breakpoint.
+    ASSERT(host.has_exited());
+    ASSERT_EQ(host.get_exit_code(), 3);
+    ASSERT_EQ(core.get_pc(), 0x88);
+
+    char buffer[16] = {};
+    ASSERT_EQ(read(out[0], buffer, sizeof(buffer)), 6);
+    ASSERT(strcmp(buffer, "hello\n") == 0);
+    ASSERT_EQ(*mem.address<u32>(0x480), 0u);
+
+    // read returns the number of bytes not read.
+    ASSERT_EQ(*mem.address<u32>(0x484), 11u);
+    ASSERT(memcmp(mem.address<char>(0x600), "input", 5) == 0);
+    ASSERT_EQ(*mem.address<u32>(0x488), 0u);
+
+    ASSERT_EQ(host.open("/nonexistent/riscv_isa", 0), -1);
+    ASSERT_EQ(host.get_errno(), ENOENT);
+    ASSERT_EQ(host.close(64), -1);
+    ASSERT_EQ(host.get_errno(), EBADF);
+
+    // a parameter block which is not word aligned is a fault.
+    core.set_x(NoneHart::IntRegT::A0, Semihosting::SYS_FLEN);
+    core.set_x(NoneHart::IntRegT::A1, 0x402);
+    ASSERT(host.call(core));
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A0), -1);
+    ASSERT_EQ(host.get_errno(), EFAULT);
+
+    // hart 0 exits while the others spin, the exit stops all of them.
+    Semihosting machine_host{-1, out[1], out[1]};
+    Machine<NoneHart> machine{3, 0x100, mem};
+    for (usize i = 0; i < machine.get_hart_num(); ++i) machine.get_hart(i).set_x(NoneHart::IntRegT::A2, i);
+    machine.set_semihosting(&machine_host);
+    machine.start();
+    machine.join();
+
+    ASSERT(machine_host.has_exited());
+    ASSERT_EQ(machine_host.get_exit_code(), 0);
+    ASSERT_EQ(machine.get_hart(0).get_pc(), 0x118);
+
+    unlink(path);
+    close(out[0]);
+    close(out[1]);
+}
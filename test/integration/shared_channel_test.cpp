@@ -0,0 +1,108 @@
+#include <chrono>
+#include <sys/mman.h>
+
+#include "test.hpp"
+#include "none_hart.hpp"
+#include "target/machine.hpp"
+#include "device/shared_channel.hpp"
+
+
+int main() {
+    u32 text[] = {
+            //    main:
+            0x100002B7, //        lui t0, 0x10000 # channel     0x00
+            //    wait:
+            0x0202A303, //        lw t1, 0x20(t0)               0x04
+            0xFE030EE3, //        beqz t1, wait                 0x08
+            0x0262A223, //        sw t1, 0x24(t0)               0x0c
+            0x0042A583, //        lw a1, 0x04(t0)               0x10
+            0x0102A603, //        lw a2, 0x10(t0)               0x14
+            0x00C586B3, //        add a3, a1, a2                0x18
+            0x00000713, //        addi a4, x0, 0                0x1c
+            0x00000793, //        addi a5, x0, 0                0x20
+            //    copy:
+            0x02C70263, //        beq a4, a2, done              0x24
+            0x00E583B3, //        add t2, a1, a4                0x28
+            0x0003CE03, //        lbu t3, 0(t2)                 0x2c
+            0x001E0E13, //        addi t3, t3, 1                0x30
+            0x00E68EB3, //        add t4, a3, a4                0x34
+            0x01CE8023, //        sb t3, 0(t4)                  0x38
+            0x01C787B3, //        add a5, a5, t3                0x3c
+            0x00170713, //        addi a4, a4, 1                0x40
+            0xFE1FF06F, //        j copy                        0x44
+            //    done:
+            0x00C2AA23, //        sw a2, 0x14(t0)               0x48
+            0x00C2AC23, //        sw a2, 0x18(t0)               0x4c
+            0x00F2AE23, //        sw a5, 0x1c(t0) # doorbell    0x50
+            0x00A00513, //        addi a0, x0, 10               0x54
+            0x00000073, //        ecall # Exit                  0x58
+    };
+
+    constexpr u64 REGISTER_BASE = 0x10000000, BUFFER_BASE = 0x20000000, BUFFER_SIZE = 0x10000, INPUT = 0x1000;
+
+    NoneHart::MemT mem{4096};
+    if (mem.address<void>(0) == nullptr) riscv_isa_abort("memory allocate failed");
+
+    mem.memory_copy(0, text, sizeof(text));
+
+    void *memory = mmap(nullptr, BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    ASSERT(memory != MAP_FAILED);
+    u8 *buffer = static_cast<u8 *>(memory);
+
+    MMIOBus bus{};
+    SharedChannel channel{buffer, BUFFER_SIZE};
+
+    // a failed map leaves the registers unmapped as well.
+    constexpr u64 TAKEN = 0x30000000;
+    ASSERT(bus.map_memory(TAKEN, 16, buffer));
+    ASSERT(!channel.map(bus, REGISTER_BASE, TAKEN - 8));
+    ASSERT(!channel.map(bus, REGISTER_BASE, REGISTER_BASE));
+    ASSERT(!bus.overlaps(REGISTER_BASE, SharedChannel::SIZE));
+
+    ASSERT(channel.map(bus, REGISTER_BASE, BUFFER_BASE));
+    ASSERT(!bus.map_memory(BUFFER_BASE + BUFFER_SIZE - 8, 16, buffer));
+
+    // harts reach the buffer itself, not a copy of it.
+    ASSERT(bus.address<u32>(BUFFER_BASE + 8) == reinterpret_cast<u32 *>(buffer + 8));
+    ASSERT(bus.address<u32>(BUFFER_BASE + BUFFER_SIZE - 2) == nullptr);
+    ASSERT(bus.address<u8>(REGISTER_BASE) == nullptr);
+
+    u32 val = 0;
+    ASSERT(channel.read(SharedChannel::MAGIC_VALUE, val) && val == SharedChannel::MAGIC);
+    ASSERT(channel.read(SharedChannel::BUFFER_BASE_LOW, val) && val == BUFFER_BASE);
+    ASSERT(channel.read(SharedChannel::BUFFER_SIZE, val) && val == BUFFER_SIZE);
+    ASSERT(!channel.read(SharedChannel::DOORBELL + 2, val));
+    ASSERT(!channel.send(BUFFER_SIZE + 1));
+
+    Machine<NoneHart> machine{1, 0, mem};
+    machine.get_hart(0).bus = &bus;
+    machine.start();
+
+    // guest waits for input, writes every byte plus one right after it, and rings with the checksum.
+    u32 checksum = 0;
+    for (usize i = 0; i < INPUT; ++i) {
+        buffer[i] = static_cast<u8>(i % 251);
+        checksum += buffer[i] + 1u;
+    }
+    ASSERT(channel.send(INPUT));
+
+    u32 seen = 0;
+    ASSERT(channel.wait_doorbell(seen, std::chrono::seconds{30}));
+    ASSERT_EQ(seen, 1u);
+    machine.join();
+
+    u64 length = 0;
+    const u8 *output = channel.get_output(length, val);
+    ASSERT(output == buffer + INPUT);
+    ASSERT_EQ(length, INPUT);
+    ASSERT_EQ(val, checksum);
+
+    bool match = true;
+    for (usize i = 0; i < INPUT; ++i) match = match && output[i] == static_cast<u8>(buffer[i] + 1);
+    ASSERT(match);
+
+    ASSERT(!channel.get_interrupt());
+    ASSERT(!channel.wait_doorbell(seen, std::chrono::milliseconds{1}));
+
+    munmap(memory, BUFFER_SIZE);
+}
@@ -0,0 +1,146 @@
+#include "test.hpp"
+#include "none_hart.hpp"
+#include "target/machine.hpp"
+#include "device/clint.hpp"
+
+
+int main() {
+    u32 text[] = {
+            //    main:
+            0x10000293, //        addi t0, x0, 0x100            0x00
+            0x00100313, //        addi t1, x0, 1                0x04
+            0x3E800393, //        addi t2, x0, 1000             0x08
+            //    loop:
+            0x0062A02F, //        amoadd.w x0, t1, (t0)         0x0c
+            0xFFF38393, //        addi t2, t2, -1               0x10
+            0xFE039CE3, //        bne t2, x0, loop              0x14
+            0x00A00513, //        addi a0, x0, 10               0x18
+            0x00000073, //        ecall # Exit                  0x1c
+            //    spin:
+            0x0000006F, //        j spin                        0x20
+    };
+
+    u32 lr_sc_text[] = {
+            //    lr_sc:
+            0x20000293, //        addi t0, x0, 0x200            0x40
+            0x3E800393, //        addi t2, x0, 1000             0x44
+            //    loop:
+            //    retry:
+            0x1602A32F, //        lr.w.aqrl t1, (t0)            0x48
+            0x00130313, //        addi t1, t1, 1                0x4c
+            0x1A62AE2F, //        sc.w.rl t3, t1, (t0)          0x50
+            0xFE0E1AE3, //        bne t3, x0, retry             0x54
+            0xFFF38393, //        addi t2, t2, -1               0x58
+            0xFE0396E3, //        bne t2, x0, loop              0x5c
+            0x00A00513, //        addi a0, x0, 10               0x60
+            0x00000073, //        ecall # Exit                  0x64
+    };
+
+    u32 racy_text[] = {
+            //    racy:
+            0x30000293, //        addi t0, x0, 0x300            0x80
+            0x3E800393, //        addi t2, x0, 1000             0x84
+            //    loop:
+            0x0002A303, //        lw t1, 0(t0)                  0x88
+            0x00630E33, //        add t3, t1, t1                0x8c
+            0x006E0333, //        add t1, t3, t1                0x90
+            0x00B30333, //        add t1, t1, a1                0x94
+            0x0062A023, //        sw t1, 0(t0)                  0x98
+            0xFFF38393, //        addi t2, t2, -1               0x9c
+            0xFE0394E3, //        bne t2, x0, loop              0xa0
+            0xC0102673, //        rdtime a2                     0xa4
+            0x00A00513, //        addi a0, x0, 10               0xa8
+            0x00000073, //        ecall # Exit                  0xac
+    };
+
+    u32 wfi_text[] = {
+            //    idle:
+            0x10500073, //        wfi                           0xc0
+            0xFFDFF06F, //        j idle                        0xc4
+    };
+
+    u32 fencei_text[] = {
+            //    fencei:
+            0x0000100F, //        fence.i                       0x140
+            0x00A00513, //        addi a0, x0, 10               0x144
+            0x00000073, //        ecall # Exit                  0x148
+    };
+
+    NoneHart::MemT mem{4096};
+    if (mem.address<void>(0) == nullptr) riscv_isa_abort("memory allocate failed");
+
+    mem.memory_copy(0, text, sizeof(text));
+    mem.memory_copy(0x40, lr_sc_text, sizeof(lr_sc_text));
+    mem.memory_copy(0x80, racy_text, sizeof(racy_text));
+    mem.memory_copy(0xc0, wfi_text, sizeof(wfi_text));
+    mem.memory_copy(0x140, fencei_text, sizeof(fencei_text));
+
+    // every hart adds to the same word, harts end by themselves.
+    Machine<NoneHart> machine{4, 0, mem};
+    machine.start();
+    machine.join();
+
+    ASSERT_EQ(*mem.address<u32>(0x100), 4000u);
+
+    // every hart increments the same word with lr/sc, no increment may be lost.
+    Machine<NoneHart> lr_sc{4, 0x40, mem};
+    lr_sc.start();
+    lr_sc.join();
+
+    ASSERT_EQ(*mem.address<u32>(0x200), 4000u);
+
+    // non atomic read modify write, result depends only on the interleaving.
+    u32 result[2];
+
+    for (u32 &val: result) {
+        *mem.address<u32>(0x300) = 0;
+
+        Machine<NoneHart> racy{3, 0x80, mem};
+        for (usize i = 0; i < racy.get_hart_num(); ++i)
+            racy.get_hart(i).set_x(NoneHart::IntRegT::A1, i + 1);
+
+        racy.run_deterministic(100);
+        val = *mem.address<u32>(0x300);
+
+        for (usize i = 0; i < racy.get_hart_num(); ++i)
+            ASSERT_EQ(racy.get_hart(i).get_x(NoneHart::IntRegT::A2), 7002);
+    }
+
+    ASSERT_EQ(result[0], result[1]);
+
+    // harts sleep in wfi, hart 0 is woken by an ipi and ends in the default interrupt handler, hart 1 by stop.
+    Machine<NoneHart> ipi{2, 0xc0, mem};
+    CLINT<NoneHart> clint{};
+    for (usize i = 0; i < ipi.get_hart_num(); ++i) {
+        ipi.get_hart(i).set_mie_csr_reg(1u << trap::MACHINE_SOFTWARE_INTERRUPT);
+        clint.attach(ipi.get_hart(i));
+    }
+
+    ipi.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    ASSERT(clint.write(0x0, 1));
+    ASSERT(!clint.write(0x8, 1));
+    ipi.stop();
+    ipi.join();
+
+    u32 msip = 0;
+    ASSERT(clint.read(0x0, msip) && msip == 1);
+    ASSERT(clint.read(0x4, msip) && msip == 0);
+    ASSERT_EQ(ipi.get_hart(0).get_pc(), 0xc4);
+
+    // hart 0 flushes by its own fence.i, hart 1 at its block boundary and again by its own fence.i.
+    Machine<NoneHart> fencei{2, 0x140, mem};
+    fencei.run_deterministic();
+
+    ASSERT_EQ(fencei.get_hart(0).decode_cache_flush_num, 1u);
+    ASSERT_EQ(fencei.get_hart(1).decode_cache_flush_num, 2u);
+
+    // harts never end by themselves, stop is required.
+    Machine<NoneHart> spin{2, 0x20, mem};
+    spin.start();
+    ASSERT(spin.is_running());
+    spin.stop();
+    spin.join();
+    ASSERT(!spin.is_running());
+    ASSERT_EQ(spin.get_hart(0).get_pc(), 0x20);
+}
@@ -0,0 +1,140 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+#include "none_hart.hpp"
+#include "target/machine.hpp"
+#include "device/clint.hpp"
+
+
+/// remembers the order events expire in, and the instret of the hart if there is one.
+struct Recorder {
+public:
+    NoneHart *hart;
+    std::vector<usize> ids;
+    std::vector<u64> instret;
+
+    void expire(usize id) {
+        ids.push_back(id);
+        if (hart != nullptr) instret.push_back(hart->get_instret());
+    }
+};
+
+
+int main() {
+    u32 text[] = {
+            //    idle:
+            0x10500073, //        wfi                           0x00
+            0xFFDFF06F, //        j idle                        0x04
+            //    spin:
+            0x0000006F, //        j spin                        0x08
+    };
+
+    NoneHart::MemT mem{4096};
+    if (mem.address<void>(0) == nullptr) riscv_isa_abort("memory allocate failed");
+
+    mem.memory_copy(0, text, sizeof(text));
+
+    // deadlines spread over every level, events expire exactly when time passes them and never before.
+    constexpr usize EVENT_NUM = 256;
+    TimerWheel wheel{};
+    Recorder recorder{nullptr, {}, {}};
+    std::vector<TimerEvent> events(EVENT_NUM);
+    std::vector<u64> deadlines(EVENT_NUM);
+
+    u64 seed = 0x9e3779b97f4a7c15;
+    for (usize i = 0; i < EVENT_NUM; ++i) {
+        seed = seed * 6364136223846793005u + 1442695040888963407u;
+        deadlines[i] = (seed >> (16 + seed % 40)) + 1000;
+        events[i].connect(recorder, i);
+        wheel.schedule(events[i], deadlines[i]);
+    }
+
+    // cancelled and moved events.
+    wheel.cancel(events[0]);
+    wheel.schedule(events[1], 150);
+    deadlines[1] = 150;
+
+    u64 earliest = TimerWheel::NO_DEADLINE;
+    for (usize i = 1; i < EVENT_NUM; ++i) earliest = deadlines[i] < earliest ? deadlines[i] : earliest;
+    ASSERT(wheel.get_deadline() <= earliest);
+
+    wheel.advance(149);
+    ASSERT(recorder.ids.empty());
+
+    bool exact = true;
+    for (u64 now = 150; recorder.ids.size() < EVENT_NUM - 1; now += now / 2) {
+        wheel.advance(now);
+        for (usize i = 1; i < EVENT_NUM; ++i) exact = exact && wheel.is_pending(events[i]) == (deadlines[i] > now);
+    }
+    ASSERT(exact);
+    ASSERT_EQ(recorder.ids.size(), EVENT_NUM - 1);
+    ASSERT_EQ(recorder.ids[0], 1u);
+    ASSERT_EQ(wheel.get_deadline(), TimerWheel::NO_DEADLINE);
+
+    // an event in the past expires at next advance.
+    recorder.ids.clear();
+    wheel.schedule(events[0], 5);
+    ASSERT(wheel.get_deadline() <= 5);
+    wheel.advance(wheel.get_deadline());
+    ASSERT(recorder.ids.size() == 1 && recorder.ids[0] == 0);
+
+    // in deterministic mode blocks end at the deadline, so an event expires at its exact instret.
+    NoneHart::IntRegT reg{};
+    NoneHart hart{0, 0x08, reg, mem};
+    Recorder hart_recorder{&hart, {}, {}};
+    TimerEvent first{}, second{};
+    first.connect(hart_recorder, 1);
+    second.connect(hart_recorder, 2);
+
+    hart.set_deterministic(true);
+    hart.schedule_timer(first, 1000);
+    hart.schedule_timer(second, 1500);
+    bool running = true;
+    while (running && hart.get_instret() < 2000) running = hart.run(NoneHart::BLOCK_BUDGET);
+    ASSERT(running);
+
+    ASSERT_EQ(hart_recorder.ids.size(), 2u);
+    ASSERT_EQ(hart_recorder.instret[0], 1000u);
+    ASSERT_EQ(hart_recorder.instret[1], 1500u);
+
+    // mtimecmp wakes a hart sleeping in wfi at its time, and ends in the default timer interrupt handler. the first
+    // mtimecmp is far away, moving it nearer wakes the hart to sleep until the new one.
+    Machine<NoneHart> machine{1, 0, mem};
+    NoneHart &hart0 = machine.get_hart(0);
+    CLINT<NoneHart> clint{};
+    clint.attach(hart0);
+    hart0.set_mie_csr_reg(1u << trap::MACHINE_TIMER_INTERRUPT);
+
+    u32 val = 0;
+    ASSERT(clint.read(CLINT<NoneHart>::MTIMECMP_BASE + 4, val) && val == 0xffffffffu);
+    ASSERT(!clint.read(CLINT<NoneHart>::MTIMECMP_BASE + 8, val));
+    clint.set_mtimecmp(0, clint.get_mtime() + RISCV_TIME_FREQUENCY * 60);
+    ASSERT_EQ(hart0.get_interrupt_pending(), 0u);
+
+    auto begin = std::chrono::steady_clock::now();
+    machine.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+    // low word goes to all ones first, so no value in between is earlier than both the old and new mtimecmp.
+    u64 mtimecmp = clint.get_mtime() + RISCV_TIME_FREQUENCY / 50;
+    ASSERT(clint.write(CLINT<NoneHart>::MTIMECMP_BASE, 0xffffffffu));
+    ASSERT(clint.write(CLINT<NoneHart>::MTIMECMP_BASE + 4, static_cast<u32>(mtimecmp >> 32)));
+    ASSERT(clint.write(CLINT<NoneHart>::MTIMECMP_BASE, static_cast<u32>(mtimecmp)));
+    ASSERT_EQ(clint.get_mtimecmp(0), mtimecmp);
+    machine.join();
+
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    ASSERT(elapsed >= std::chrono::milliseconds{30} && elapsed < std::chrono::seconds{30});
+    ASSERT(clint.read(CLINT<NoneHart>::MTIME, val));
+    ASSERT(clint.get_mtime() >= mtimecmp);
+    ASSERT_EQ(hart0.get_interrupt_pending(), 1u << trap::MACHINE_TIMER_INTERRUPT);
+    ASSERT_EQ(hart0.get_pc(), 0x4);
+
+    // a mtimecmp already passed raises the interrupt at once, a later one clears it.
+    clint.set_mtimecmp(0, 0);
+    ASSERT_EQ(hart0.get_interrupt_pending(), 1u << trap::MACHINE_TIMER_INTERRUPT);
+    clint.set_mtimecmp(0, clint.get_mtime() + RISCV_TIME_FREQUENCY);
+    ASSERT_EQ(hart0.get_interrupt_pending(), 0u);
+}
@@ -0,0 +1,103 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "test.hpp"
+#include "none_hart.hpp"
+#include "device/uart.hpp"
+
+
+int main() {
+    u32 text[] = {
+            //    main:
+            0x100002B7, //        lui t0, 0x10000 # uart          0x00
+            0x06800313, //        addi t1, x0, 'h'                0x04
+            0x00628023, //        sb t1, 0(t0)                    0x08
+            0x06900313, //        addi t1, x0, 'i'                0x0c
+            0x00628023, //        sb t1, 0(t0)                    0x10
+            0x00A00313, //        addi t1, x0, '\n'               0x14
+            0x00628023, //        sb t1, 0(t0)                    0x18
+            0x06F00313, //        addi t1, x0, 'o'                0x1c
+            0x00628023, //        sb t1, 0(t0)                    0x20
+            //    wait:
+            0x0052C383, //        lbu t2, 5(t0) # lsr             0x24
+            0x0013F393, //        andi t2, t2, 1                  0x28
+            0xFE038CE3, //        beq t2, x0, wait                0x2c
+            0x0002C583, //        lbu a1, 0(t0) # rbr             0x30
+            0x0052C603, //        lbu a2, 5(t0) # lsr             0x34
+            0x00A00513, //        addi a0, x0, 10                 0x38
+            0x00000073, //        ecall # Exit                    0x3c
+    };
+
+    u32 prompt_text[] = {
+            //    prompt:
+            0x100002B7, //        lui t0, 0x10000 # uart          0x100
+            0x07000313, //        addi t1, x0, 'p'                0x104
+            0x00628023, //        sb t1, 0(t0)                    0x108
+            0x000403B7, //        lui t2, 0x40                    0x10c
+            //    loop:
+            0xFFF38393, //        addi t2, t2, -1                 0x110
+            0xFE039EE3, //        bne t2, x0, loop                0x114
+            0x00A00513, //        addi a0, x0, 10                 0x118
+            0x00000073, //        ecall # Exit                    0x11c
+    };
+
+    int in[2], out[2];
+    ASSERT(pipe(in) == 0 && pipe(out) == 0);
+    ASSERT(fcntl(out[0], F_SETFL, O_NONBLOCK) == 0);
+    ASSERT(write(in[1], "x", 1) == 1);
+
+    NoneHart::IntRegT reg{};
+
+    NoneHart::MemT mem{4096};
+    if (mem.address<void>(0) == nullptr) riscv_isa_abort("memory allocate failed");
+
+    mem.memory_copy(0, text, sizeof(text));
+    mem.memory_copy(0x100, prompt_text, sizeof(prompt_text));
+
+    UART uart{in[0], out[1]};
+    MMIOBus bus{};
+    ASSERT(bus.map(0x10000000, 0x100, uart));
+
+    NoneHart core{0, 0, reg, mem};
+    core.bus = &bus;
+    core.start();
+
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A1), 'x');
+    ASSERT_EQ(core.get_x(NoneHart::IntRegT::A2), UART::LSR_THRE | UART::LSR_TEMT);
+
+    // the line is written on newline, the byte after it stays buffered until flush.
+    char buffer[16];
+    ASSERT_EQ(read(out[0], buffer, sizeof(buffer)), 3);
+    ASSERT(buffer[0] == 'h' && buffer[1] == 'i' && buffer[2] == '\n');
+    ASSERT(read(out[0], buffer, sizeof(buffer)) == -1 && errno == EAGAIN);
+
+    uart.flush();
+    ASSERT_EQ(read(out[0], buffer, sizeof(buffer)), 1);
+    ASSERT_EQ(buffer[0], 'o');
+
+    // transmitter empty interrupt is raised when enabled and acknowledged by reading iir.
+    u32 val = 0;
+    ASSERT(!uart.get_interrupt());
+    ASSERT(uart.write(UART::IER_DLM, UART::IER_THRI));
+    ASSERT(uart.get_interrupt());
+    ASSERT(uart.read(UART::IIR_FCR, val) && val == UART::IIR_THRI);
+    ASSERT(!uart.get_interrupt());
+    ASSERT(uart.read(UART::IIR_FCR, val) && val == UART::IIR_NO_INT);
+
+    // output with no newline is flushed by the timer of the attached hart while the guest keeps running, time is
+    // retired instructions here so the flush comes at the same point of every run.
+    NoneHart::IntRegT prompt_reg{};
+    NoneHart prompt{0, 0x100, prompt_reg, mem};
+    prompt.bus = &bus;
+    prompt.set_deterministic(true);
+    uart.attach(prompt);
+
+    constexpr u64 BEFORE_FLUSH = UART::FLUSH_INTERVAL_TICK - 16;
+    while (prompt.get_instret() < BEFORE_FLUSH) ASSERT(prompt.run(BEFORE_FLUSH - prompt.get_instret()));
+    ASSERT(read(out[0], buffer, sizeof(buffer)) == -1 && errno == EAGAIN);
+
+    ASSERT(prompt.run(64));
+    ASSERT_EQ(read(out[0], buffer, sizeof(buffer)), 1);
+    ASSERT_EQ(buffer[0], 'p');
+}
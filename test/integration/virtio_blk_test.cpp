@@ -0,0 +1,152 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "test.hpp"
+#include "virtio_driver.hpp"
+#include "device/virtio_blk.hpp"
+
+using namespace riscv_isa;
+
+
+/// requests live after the rings of queue 0, slot i has its own header, data and status.
+constexpr u64 HEADER = 0x4000, DATA = 0x5000, STATUS = 0x6000;
+
+/// chain of header, one data buffer of length and status at slot, not yet made available.
+void request(Driver<VirtioBlk> &driver, u16 slot, u32 type, u64 sector, u32 length) {
+    u64 header = HEADER + slot * 16u, data = DATA + slot * 0x200u, status = STATUS + slot;
+    *driver.at<u32>(header) = type;
+    *driver.at<u64>(header + 8) = sector;
+    *driver.at<u8>(status) = 0xff;
+
+    bool in = type == VirtioBlk::T_IN || type == VirtioBlk::T_GET_ID;
+    Driver<VirtioBlk>::Buffer buffers[] = {{header, 16, false}, {data, length, in}, {status, 1, true}};
+    if (length == 0) buffers[1] = buffers[2];
+
+    driver.request(0, buffers, length != 0 ? 3 : 2);
+}
+
+u8 get_status(Driver<VirtioBlk> &driver, u16 slot) { return *driver.at<u8>(STATUS + slot); }
+
+u8 *get_data(Driver<VirtioBlk> &driver, u16 slot) { return driver.at<u8>(DATA + slot * 0x200u); }
+
+
+/// interrupt controller standing in for a plic.
+struct Sink {
+public:
+    std::atomic<bool> level;
+    usize id;
+
+    void set_irq(usize irq, bool val) {
+        id = irq;
+        level.store(val);
+    }
+};
+
+
+int main() {
+    char path[] = "/tmp/riscv_isa_virtio_blk_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT(fd >= 0);
+
+    u8 sector[512];
+    for (usize i = 0; i < 4; ++i) {
+        memset(sector, static_cast<int>('a' + i), sizeof(sector));
+        ASSERT_EQ(write(fd, sector, sizeof(sector)), 512);
+    }
+    close(fd);
+
+    u64 image_size = 0;
+    void *image = VirtioBlk::map_image(path, false, image_size);
+    ASSERT(image != MAP_FAILED);
+    ASSERT_EQ(image_size, 2048u);
+
+    void *memory = mmap(nullptr, 0x10000, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    ASSERT(memory != MAP_FAILED);
+
+    GuestRAM ram{memory, 0, 0x10000};
+    VirtioBlk blk{ram, image, image_size, false};
+
+    u32 val = 0;
+    ASSERT(blk.read(VirtioBlk::MAGIC_VALUE, val) && val == VirtioBlk::MAGIC);
+    ASSERT(blk.read(VirtioBlk::DEVICE_ID_REG, val) && val == VirtioBlk::DEVICE_ID);
+    ASSERT(blk.read(VirtioBlk::CONFIG_CAPACITY_LOW, val) && val == 4);
+    ASSERT(blk.write(VirtioBlk::DEVICE_FEATURES_SEL, 1));
+    ASSERT(blk.read(VirtioBlk::DEVICE_FEATURES, val) && val == 1);
+
+    Driver<VirtioBlk> driver{static_cast<u8 *>(memory), 0, blk};
+    driver.setup(1, 0);
+
+    // three requests for one notification are answered by one used index update and one interrupt.
+    request(driver, 0, VirtioBlk::T_IN, 2, 512);
+    memset(get_data(driver, 1), 'z', 512);
+    request(driver, 1, VirtioBlk::T_OUT, 1, 512);
+    request(driver, 2, VirtioBlk::T_IN, 4, 512);
+    driver.notify(0);
+
+    ASSERT_EQ(driver.get_used_idx(0), 3);
+    ASSERT_EQ(driver.get_used_len(0, 0), 513u);
+    ASSERT_EQ(driver.get_used_len(0, 1), 1u);
+    ASSERT_EQ(get_status(driver, 0), VirtioBlk::S_OK);
+    ASSERT_EQ(get_status(driver, 1), VirtioBlk::S_OK);
+    ASSERT_EQ(get_status(driver, 2), VirtioBlk::S_IOERR);
+    ASSERT_EQ(get_data(driver, 0)[511], 'c');
+    ASSERT_EQ(static_cast<u8 *>(image)[512], 'z');
+
+    ASSERT(blk.get_interrupt());
+    ASSERT(blk.read(VirtioBlk::INTERRUPT_STATUS, val) && val == VirtioBlk::INTERRUPT_USED_BUFFER);
+    ASSERT(blk.write(VirtioBlk::INTERRUPT_ACK, val));
+    ASSERT(!blk.get_interrupt());
+
+    // driver suppressing interrupts still gets used buffers.
+    driver.set_avail_flags(0, Virtqueue::AVAIL_F_NO_INTERRUPT);
+    request(driver, 3, VirtioBlk::T_FLUSH, 0, 0);
+    request(driver, 4, VirtioBlk::T_GET_ID, 0, 20);
+    request(driver, 5, 0x1234, 0, 0);
+    driver.notify(0);
+
+    ASSERT_EQ(driver.get_used_idx(0), 6);
+    ASSERT_EQ(get_status(driver, 3), VirtioBlk::S_OK);
+    ASSERT_EQ(get_status(driver, 4), VirtioBlk::S_OK);
+    ASSERT(memcmp(get_data(driver, 4), "riscv-isa", 10) == 0);
+    ASSERT_EQ(get_status(driver, 5), VirtioBlk::S_UNSUPP);
+    ASSERT(!blk.get_interrupt());
+
+    // with an io pool the notifying store returns at once, and completion arrives as interrupt.
+    void *memory_async = mmap(nullptr, 0x10000, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    ASSERT(memory_async != MAP_FAILED);
+
+    {
+        IOThreadPool pool{2};
+        Sink sink{{false}, 0};
+        VirtioBlk blk_async{GuestRAM{memory_async, 0, 0x10000}, image, image_size, false};
+        blk_async.set_io_pool(&pool);
+        blk_async.get_irq_line().connect(sink, 7);
+
+        Driver<VirtioBlk> driver_async{static_cast<u8 *>(memory_async), 0, blk_async};
+        driver_async.setup(1, 0);
+        for (u16 i = 0; i < 4; ++i) request(driver_async, i, VirtioBlk::T_IN, i, 512);
+        driver_async.notify(0);
+        pool.wait_idle();
+
+        ASSERT_EQ(driver_async.get_used_idx(0), 4);
+        ASSERT_EQ(get_data(driver_async, 3)[0], 'd');
+        ASSERT_EQ(get_data(driver_async, 1)[0], 'z');
+        ASSERT(sink.level.load() && sink.id == 7);
+
+        ASSERT(blk_async.write(VirtioBlk::INTERRUPT_ACK, VirtioBlk::INTERRUPT_USED_BUFFER));
+        ASSERT(!sink.level.load());
+    }
+
+    // the write reached the file.
+    fd = open(path, O_RDONLY);
+    ASSERT(fd >= 0 && pread(fd, sector, sizeof(sector), 512) == 512 && sector[0] == 'z');
+    close(fd);
+
+    munmap(memory, 0x10000);
+    munmap(memory_async, 0x10000);
+    munmap(image, image_size);
+    unlink(path);
+}
@@ -0,0 +1,171 @@
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "test.hpp"
+#include "virtio_driver.hpp"
+#include "device/virtio_console.hpp"
+#include "device/virtio_rng.hpp"
+#include "device/virtio_net.hpp"
+
+using namespace riscv_isa;
+
+
+int main() {
+    constexpr u64 DATA = 0x10000, MEMORY_SIZE = 0x40000;
+    void *memory = mmap(nullptr, MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    ASSERT(memory != MAP_FAILED);
+    u8 *ram = static_cast<u8 *>(memory);
+
+    int in[2], out[2];
+    ASSERT(pipe(in) == 0 && pipe(out) == 0);
+
+    VirtioConsole console{GuestRAM{memory, 0, MEMORY_SIZE}, in[0], out[1]};
+
+    u32 val = 0;
+    ASSERT(console.read(VirtioConsole::DEVICE_ID_REG, val) && val == VirtioConsole::DEVICE_ID);
+    ASSERT(console.read(VirtioConsole::CONFIG_COLS_ROWS + 2, val) && (val & 0xffff) == 25);
+    ASSERT(console.read(VirtioConsole::CONFIG_MAX_NR_PORTS, val) && val == 1);
+    ASSERT(!console.read(VirtioConsole::CONFIG + 0xc, val));
+    ASSERT(!console.read(VirtioConsole::QUEUE_SEL + 2, val));
+    ASSERT(console.write(VirtioConsole::QUEUE_SEL, 2));
+    ASSERT(console.read(VirtioConsole::QUEUE_NUM_MAX_REG, val) && val == 0);
+
+    Driver<VirtioConsole> driver{ram, 0, console};
+    driver.setup(2, static_cast<u32>(VirtioConsole::F_EVENT_IDX));
+
+    // output of three chains for one doorbell arrives in the pipe by a single write.
+    const char *text = "hello virtio console\n";
+    memcpy(ram + DATA, text, strlen(text));
+    u32 lengths[] = {6, 7, 8};
+    for (usize i = 0, offset = 0; i < 3; offset += lengths[i++])
+        driver.request(VirtioConsole::TRANSMIT_QUEUE, DATA + offset, lengths + i, 1, false);
+    driver.set_used_event(VirtioConsole::TRANSMIT_QUEUE, 0);
+    driver.notify(VirtioConsole::TRANSMIT_QUEUE);
+
+    char buffer[64] = {};
+    ASSERT_EQ(read(out[0], buffer, sizeof(buffer)), static_cast<ssize_t>(strlen(text)));
+    ASSERT(strcmp(buffer, text) == 0);
+    ASSERT_EQ(driver.get_used_idx(VirtioConsole::TRANSMIT_QUEUE), 3);
+    ASSERT(console.get_interrupt());
+    driver.ack();
+
+    // device asks to be notified of the next buffer only.
+    ASSERT_EQ(driver.get_avail_event(VirtioConsole::TRANSMIT_QUEUE), 3);
+
+    // with event idx the driver wants an interrupt only once used index passes used event.
+    driver.set_used_event(VirtioConsole::TRANSMIT_QUEUE, 4);
+    driver.request(VirtioConsole::TRANSMIT_QUEUE, DATA, lengths, 1, false);
+    driver.notify(VirtioConsole::TRANSMIT_QUEUE);
+    ASSERT_EQ(driver.get_used_idx(VirtioConsole::TRANSMIT_QUEUE), 4);
+    ASSERT(!console.get_interrupt());
+    driver.request(VirtioConsole::TRANSMIT_QUEUE, DATA, lengths, 1, false);
+    driver.notify(VirtioConsole::TRANSMIT_QUEUE);
+    ASSERT(console.get_interrupt());
+    driver.ack();
+    ASSERT_EQ(read(out[0], buffer, sizeof(buffer)), 12);
+
+    // receive buffers wait for input, which fills one chain per read.
+    u32 rx_lengths[] = {4, 4};
+    driver.set_used_event(VirtioConsole::RECEIVE_QUEUE, 0);
+    driver.request(VirtioConsole::RECEIVE_QUEUE, DATA + 0x100, rx_lengths, 2, true);
+    driver.request(VirtioConsole::RECEIVE_QUEUE, DATA + 0x200, rx_lengths, 2, true);
+    driver.notify(VirtioConsole::RECEIVE_QUEUE);
+    ASSERT_EQ(driver.get_used_idx(VirtioConsole::RECEIVE_QUEUE), 0);
+
+    ASSERT_EQ(write(in[1], "typed", 5), 5);
+    console.poll();
+    ASSERT_EQ(driver.get_used_idx(VirtioConsole::RECEIVE_QUEUE), 1);
+    ASSERT_EQ(driver.get_used_len(VirtioConsole::RECEIVE_QUEUE, 0), 5u);
+    ASSERT(memcmp(ram + DATA + 0x100, "typed", 5) == 0);
+    ASSERT(console.get_interrupt());
+
+    console.poll();
+    ASSERT_EQ(driver.get_used_idx(VirtioConsole::RECEIVE_QUEUE), 1);
+    ASSERT_EQ(console.get_dropped(), 0u);
+
+    // entropy fills every writable buffer of a chain.
+    VirtioRNG rng{GuestRAM{memory, 0, MEMORY_SIZE}};
+    ASSERT(rng.read(VirtioRNG::DEVICE_ID_REG, val) && val == VirtioRNG::DEVICE_ID);
+
+    memset(ram + DATA, 0, 0x1000);
+    Driver<VirtioRNG> rng_driver{ram, 0x8000, rng};
+    u32 rng_lengths[] = {64, 64};
+    rng_driver.setup(1, 0);
+    rng_driver.request(0, DATA, rng_lengths, 2, true);
+    rng_driver.notify(0);
+
+    ASSERT_EQ(rng_driver.get_used_idx(0), 1);
+    ASSERT_EQ(rng_driver.get_used_len(0, 0), 128u);
+    usize zero = 0;
+    for (usize i = 0; i < 128; ++i) zero += ram[DATA + i] == 0 ? 1 : 0;
+    ASSERT(zero < 16);
+    ASSERT(rng.get_interrupt());
+
+    // frames of one device arrive at the other through a socket pair, a batch by one sendmmsg and one recvmmsg.
+    constexpr u64 TX = 0x30000, RX = 0x31000;
+    int link[2];
+    ASSERT(VirtioNet::make_link(link));
+
+    const u8 mac_a[] = {0x52, 0x54, 0x00, 0x12, 0x34, 0x56}, mac_b[] = {0x52, 0x54, 0x00, 0x12, 0x34, 0x57};
+    VirtioNet net_a{GuestRAM{memory, 0, MEMORY_SIZE}, link[0], mac_a};
+    VirtioNet net_b{GuestRAM{memory, 0, MEMORY_SIZE}, link[1], mac_b};
+    ASSERT(net_a.read(VirtioNet::DEVICE_ID_REG, val) && val == VirtioNet::DEVICE_ID);
+    ASSERT(net_a.read(VirtioNet::DEVICE_FEATURES, val) && (val & VirtioNet::F_MAC) != 0);
+    ASSERT(net_a.read(VirtioNet::CONFIG_MAC, val) && val == 0x12005452u);
+    ASSERT(net_b.read(VirtioNet::CONFIG_MAC + 4, val) && (val & 0xffff) == 0x5734);
+    ASSERT(net_b.read(VirtioNet::CONFIG_STATUS, val) && (val & 0xffff) == VirtioNet::S_LINK_UP);
+
+    Driver<VirtioNet> net_driver_a{ram, 0x20000, net_a}, net_driver_b{ram, 0x28000, net_b};
+    net_driver_a.setup(2, 0);
+    net_driver_b.setup(2, 0);
+
+    // receive buffers for two of three frames.
+    u32 rx_length = 0x100;
+    for (usize i = 0; i < 2; ++i) net_driver_b.request(VirtioNet::RECEIVE_QUEUE, RX + i * 0x100, &rx_length, 1, true);
+    net_driver_b.notify(VirtioNet::RECEIVE_QUEUE);
+    ASSERT_EQ(net_driver_b.get_used_idx(VirtioNet::RECEIVE_QUEUE), 0);
+
+    // header and frame in separate buffers.
+    u32 tx_lengths[] = {VirtioNet::HEADER_SIZE, 64};
+    for (usize i = 0; i < 3; ++i) {
+        memset(ram + TX + i * 0x100 + VirtioNet::HEADER_SIZE, static_cast<int>(0xa0 + i), 64);
+        net_driver_a.request(VirtioNet::TRANSMIT_QUEUE, TX + i * 0x100, tx_lengths, 2, false);
+    }
+    net_driver_a.notify(VirtioNet::TRANSMIT_QUEUE);
+    ASSERT_EQ(net_driver_a.get_used_idx(VirtioNet::TRANSMIT_QUEUE), 3);
+    ASSERT(net_a.get_interrupt());
+
+    net_b.poll();
+    ASSERT_EQ(net_driver_b.get_used_idx(VirtioNet::RECEIVE_QUEUE), 2);
+    ASSERT_EQ(net_driver_b.get_used_len(VirtioNet::RECEIVE_QUEUE, 1), VirtioNet::HEADER_SIZE + 64);
+    ASSERT_EQ(ram[RX + 0x100 + 10], 1); // num_buffers
+    ASSERT(ram[RX + 0x100 + VirtioNet::HEADER_SIZE] == 0xa1 && ram[RX + 0x100 + VirtioNet::HEADER_SIZE + 63] == 0xa1);
+    ASSERT(net_b.get_interrupt());
+
+    // the third frame waits in the socket for the next receive buffer.
+    net_driver_b.request(VirtioNet::RECEIVE_QUEUE, RX + 0x200, &rx_length, 1, true);
+    net_driver_b.notify(VirtioNet::RECEIVE_QUEUE);
+    ASSERT_EQ(net_driver_b.get_used_idx(VirtioNet::RECEIVE_QUEUE), 3);
+    ASSERT_EQ(ram[RX + 0x200 + VirtioNet::HEADER_SIZE], 0xa2);
+    ASSERT_EQ(net_a.get_dropped(), 0u);
+    ASSERT_EQ(net_b.get_dropped(), 0u);
+
+    // a frame longer than its receive buffer is dropped, its buffer is used with no data.
+    u32 short_length = 40;
+    net_driver_a.request(VirtioNet::TRANSMIT_QUEUE, TX, tx_lengths, 2, false);
+    net_driver_a.notify(VirtioNet::TRANSMIT_QUEUE);
+    net_driver_b.request(VirtioNet::RECEIVE_QUEUE, RX + 0x300, &short_length, 1, true);
+    net_driver_b.notify(VirtioNet::RECEIVE_QUEUE);
+    ASSERT_EQ(net_driver_b.get_used_idx(VirtioNet::RECEIVE_QUEUE), 4);
+    ASSERT_EQ(net_driver_b.get_used_len(VirtioNet::RECEIVE_QUEUE, 3), 0u);
+    ASSERT_EQ(net_b.get_dropped(), 1u);
+
+    close(link[0]);
+    close(link[1]);
+    close(in[0]);
+    close(in[1]);
+    close(out[0]);
+    close(out[1]);
+    munmap(memory, MEMORY_SIZE);
+}
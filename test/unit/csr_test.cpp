@@ -0,0 +1,27 @@
+#include "test.hpp"
+#include "register/csr_register.hpp"
+
+using namespace riscv_isa;
+
+
+using CSRRegT = CSRRegister<xlen_trait>;
+
+int main() {
+    usize defined = 0;
+
+    for (usize csr = 0; csr < CSRRegT::CSR_ADDRESS_NUM; ++csr) {
+        const CSRRegT::CSRInfo &info = CSRRegT::get_csr_info(csr);
+
+        ASSERT_EQ(static_cast<usize>(info.privilege), (get_bits<usize, 10, 8>(csr)));
+        ASSERT_EQ(info.read_only, CSRRegT::get_read_write_bits(csr) == CSRRegT::READ_ONLY_BITS);
+
+        if (info.index != CSRRegT::CSR_REGISTER_NUM) ++defined;
+    }
+
+    ASSERT_EQ(defined, static_cast<usize>(CSRRegT::CSR_REGISTER_NUM));
+
+#define _riscv_isa_check_csr_index(NAME, name, num) \
+    ASSERT_EQ(CSRRegT::get_index(num), static_cast<usize>(CSRRegT::NAME));
+    riscv_isa_csr_reg_map(_riscv_isa_check_csr_index)
+#undef _riscv_isa_check_csr_index
+}